@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <sys/time.h>
 #include <stdint.h>
@@ -8,51 +9,48 @@
 #include <math.h>
 #include <string.h>
 #include <limits.h>
+#include <getopt.h>
+#include "oshmem_bench_timer.h"
+#include "oshmem_bench_sync_algorithms.h"
+#include "oshmem_bench_scale.h"
+#include "oshmem_bench_affinity.h"
+#include "oshmem_bench_stats.h"
+#include "oshmem_bench_collectives.h"
+#include "oshmem_bench_perf.h"
 
 #define BENCHMARK "OpenSHMEM shmem_sunc_all() avg latency Test"
 #define SKIP_DEFAULT                    (200)
 #define ITERATIONS_DEFAULT              (10000)
 
-long pSyncRed1[_SHMEM_REDUCE_SYNC_SIZE];
-long pSyncRed2[_SHMEM_REDUCE_SYNC_SIZE];
-double pWrk1[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
-double pWrk2[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
-
 void empty_func(){}
 
-int64_t get_microsec_time_stamp()
+// With perf, the counters are read around the whole timed loop; perf_delta() / iterations is the count per call.
+void run_local_avg_latency_benchmark(void (*func)(void), void (*pre_func)(void), int iterations, int skip, double* local_avg,
+                                     perf_t* perf)
 {
-    int64_t retval;
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL))
-    {
-        perror("gettimeofday");
-        abort();
-    }
-    retval = ((int64_t)tv.tv_sec) * 1000000 + tv.tv_usec;
-    return retval;
-}
-
-void run_local_avg_latency_benchmark(void (*func)(void), int iterations, int skip, double* local_avg)
-{
-    int64_t t_start, t_stop;
+    uint64_t t_start, t_stop;
     int i = 0;
     for (i = 0; i < skip; i++)
         func();
-    shmem_barrier_all();
-    t_start = get_microsec_time_stamp();
+    pre_func();
+    if (perf)
+        perf_read(perf, perf->before);
+    t_start = timer_read();
     for (i = 0; i < iterations; i++)
         func();
-    t_stop = get_microsec_time_stamp();
-    *local_avg =  (t_stop - t_start) / (double)iterations;
+    t_stop = timer_read();
+    if (perf)
+        perf_read(perf, perf->after);
+    *local_avg =  timer_ticks_to_usec(t_stop - t_start) / (double)iterations;
 }
 
 void print_results(FILE *stream, int verbosity_level, int my_pe, int iterations, int skip, int num_pes,
-                    double* global_avg, double* global_min, double* global_max, char* func_name)
+                    const data_t* avg, char* func_name)
 {
     shmem_barrier_all();
     if (my_pe == 0) {
         fprintf(stream, "# %s\n", BENCHMARK);
+        timer_print_info(stream, my_pe);
         
         //Results header
         fprintf(stream, "%*s", 5, "# Avg");
@@ -65,13 +63,16 @@ void print_results(FILE *stream, int verbosity_level, int my_pe, int iterations,
         fflush(stream);
 
         //Results data
-        fprintf(stream, "%*.2f", 5, *global_avg);
-        fprintf(stream, "%*.2f", 10, *global_min);
-        fprintf(stream, "%*.2f", 10, *global_max);
+        fprintf(stream, "%*.2f", 5, avg->avg);
+        fprintf(stream, "%*.2f", 10, avg->range_from);
+        fprintf(stream, "%*.2f", 10, avg->range_to);
         fprintf(stream, "%*d", 7, iterations);
         fprintf(stream, "%*d", 5, skip);
         fprintf(stream, "%*d", 6, num_pes);
         fprintf(stream, "%*s\n", 20, func_name);
+        fprintf(stream, "# Across PEs (median/stddev/CV):");
+        stats_print_spread(stream, "Avg", avg);
+        fprintf(stream, "\n");
     }
     
     if (verbosity_level == 1)
@@ -94,17 +95,154 @@ void print_results(FILE *stream, int verbosity_level, int my_pe, int iterations,
     }    
 }
 
+// Counters per call reduced over all PEs: counts[e] and available[e] for every event e.
+void print_perf_results(FILE *stream, int my_pe, const perf_t* perf, const data_t* counters)
+{
+    if (my_pe == 0) {
+        const data_t *counts = &counters[0], *available = &counters[PERF_EVENTS_MAX];
+        char temp_str[200];
+        int e;
+
+        fprintf(stream, "# Hardware counters per call, avg [min-max] over PEs:\n");
+        for (e = 0; e < PERF_EVENTS_MAX; e++)
+        {
+            sprintf(temp_str, "%s%s", perf_events[e].name,
+                    (perf->slot[e] >= 0 && perf->user_only[e]) ? ":u" : (perf->slot[e] < 0 && perf_available(perf, e)) ? ":rusage" : "");
+            fprintf(stream, "# %*s", 20, temp_str);
+            if (available[e].range_from == 0)
+                sprintf(temp_str, "n/a");
+            else
+                sprintf(temp_str, "%.1f [%.1f-%.1f]", counts[e].avg, counts[e].range_from, counts[e].range_to);
+            fprintf(stream, "%*s\n", 24, temp_str);
+        }
+    }
+}
+
+// Runs func on every subset of the scaling sweep: one row per PE count, then the log2(P) fit.
+void run_scale_sweep(FILE *stream, int my_pe, int num_pes, void (*func_ptr)(void), char* func_name, int iterations, int skip)
+{
+    static data_t avg;
+    double fit[SCALE_SIZES_MAX];
+    int sizes[SCALE_SIZES_MAX];
+    int nsizes = scale_sizes(num_pes, sizes), s, group_size;
+
+    if (my_pe == 0) {
+        fprintf(stream, "# %s\n", BENCHMARK);
+        timer_print_info(stream, my_pe);
+        fprintf(stream, "# Scaling sweep of %s over PEs 0..P-1, %d iterations, %d skip\n", func_name, iterations, skip);
+
+        //Results header
+        fprintf(stream, "%*s", 6, "#PEs");
+        fprintf(stream, "%*s", 10, "Avg");
+        fprintf(stream, "%*s", 10, "Min");
+        fprintf(stream, "%*s\n", 10, "Max");
+    }
+
+    for (s = 0; s < nsizes; s++)
+    {
+        group_size = sizes[s];
+        scale_set_group(group_size);
+        if (my_pe < group_size)
+        {
+            run_local_avg_latency_benchmark(scale_func(func_ptr), &scale_align, iterations, skip, &(avg.local), NULL);
+            stats_reduce(&avg, 1, group_size);
+
+            if (my_pe == 0)
+            {
+                fprintf(stream, "%*d", 6, group_size);
+                fprintf(stream, "%*.2f", 10, avg.avg);
+                fprintf(stream, "%*.2f", 10, avg.range_from);
+                fprintf(stream, "%*.2f\n", 10, avg.range_to);
+                fit[s] = avg.avg;
+            }
+        }
+        shmem_barrier_all();
+    }
+
+    if (my_pe == 0)
+        scale_print_fit(stream, "Avg", nsizes, sizes, fit);
+    scale_set_group(num_pes);
+}
+
+// Runs a data-carrying collective back to back for every power-of-two message size up to max_bytes: one row
+// per size. With check, every size is verified once before it is timed.
+void run_collective_sweep(FILE *stream, int my_pe, int num_pes, const collective_t* coll, size_t max_bytes, int check,
+                          int iterations, int skip)
+{
+    // Average, then the wrong elements of the check
+    static data_t results[2];
+    size_t sizes[COLL_SIZES_MAX];
+    int nsizes = collectives_sizes(max_bytes, sizes), s;
+
+    if (my_pe == 0) {
+        fprintf(stream, "# %s\n", BENCHMARK);
+        timer_print_info(stream, my_pe);
+        fprintf(stream, "# Message-size sweep of %s on %d PEs, %d iterations, %d skip%s%s\n", coll->name, num_pes, iterations, skip,
+                check ? ", results checked" : "", (coll->back_to_back_ptr != coll->func_ptr) ? ", each call followed by a barrier" : "");
+
+        //Results header
+        fprintf(stream, "%*s", 10, "Bytes");
+        fprintf(stream, "%*s", 10, "Avg");
+        fprintf(stream, "%*s", 10, "Min");
+        fprintf(stream, "%*s", 10, "Max");
+        if (check)
+            fprintf(stream, "%*s", 8, "Check");
+        fprintf(stream, "\n");
+    }
+
+    for (s = 0; s < nsizes; s++)
+    {
+        collectives_set_size(sizes[s]);
+        results[1].local = check ? (double)collectives_check(coll) : 0;
+        run_local_avg_latency_benchmark(coll->back_to_back_ptr, &shmem_barrier_all, iterations, skip, &(results[0].local), NULL);
+        stats_reduce(results, 2, num_pes);
+
+        if (my_pe == 0)
+        {
+            fprintf(stream, "%*zu", 10, sizes[s]);
+            fprintf(stream, "%*.2f", 10, results[0].avg);
+            fprintf(stream, "%*.2f", 10, results[0].range_from);
+            fprintf(stream, "%*.2f", 10, results[0].range_to);
+            if (check)
+                fprintf(stream, "%*s", 8, (results[1].range_to > 0) ? "FAILED" : "ok");
+            fprintf(stream, "\n");
+        }
+    }
+}
+
 void print_usage(FILE *stream, const char *prog, int my_pe)
 {
     if (my_pe == 0)
     {
-        fprintf(stream, " USAGE : %s [-i ITER] [-f FUNC] [-s SKIP] [-hv] [-V VERBOSE]\n", prog);
-        fprintf(stream, "  -f : Select function {shmem_sync_all, shmem_barrier_all, empty_func} to benchmark.\n");
+        fprintf(stream, " USAGE : %s [-i ITER] [-f FUNC] [-r RADIX] [-s SKIP] [-hv] [-V VERBOSE] [-T TIMER] [-S] [-a AFFINITY]\n", prog);
+        fprintf(stream, "        [-m MAX_BYTES] [-e] [-K]\n");
+        fprintf(stream, "  -f : Select function {shmem_sync_all, shmem_barrier_all, empty_func,\n");
+        fprintf(stream, "       central_counter, dissemination, tree, butterfly, tournament,\n");
+        fprintf(stream, "       broadcast, sum_reduce, fcollect, alltoall} to benchmark.\n");
+        fprintf(stream, "       central_counter..tournament are user-level algorithms with shmem_sync_all semantics.\n");
+        fprintf(stream, "       broadcast..alltoall are data-carrying collectives on 64-bit elements (sum_reduce on doubles),\n");
+        fprintf(stream, "       swept over message sizes of %d, %d, ... MAX_BYTES per PE; -S is ignored. Back to back,\n",
+                COLL_BYTES_MIN, 2 * COLL_BYTES_MIN);
+        fprintf(stream, "       every broadcast is followed by a barrier so that the root can't run ahead.\n");
         fprintf(stream, "       By default, the value of FUNC is shmem_sync_all.\n");
+        fprintf(stream, "  -r : Set radix of the user-level sync algorithms to RADIX {2..%d}.\n", SYNC_RADIX_MAX);
+        fprintf(stream, "       By default, the value of RADIX is %d.\n", SYNC_RADIX_DEFAULT);
         fprintf(stream, "  -i : Set number of iterations to ITER.\n");
         fprintf(stream, "       By default, the value of ITER is %d.\n", ITERATIONS_DEFAULT);
         fprintf(stream, "  -s : Set number of skip-iterations to SKIP.\n");
         fprintf(stream, "       By default, the value of SKIP is %d.\n", SKIP_DEFAULT);
+        fprintf(stream, "  -T : Select time-stamp source {rdtsc, monotonic_raw, gettimeofday}.\n");
+        fprintf(stream, "       By default, the value of TIMER is rdtsc (falls back to monotonic_raw without an invariant TSC).\n");
+        fprintf(stream, "  -a : Pin every PE to one CPU by its rank on the host {compact, scatter, list:CPU,CPU,...}.\n");
+        fprintf(stream, "       compact fills one socket after the other, scatter round-robins over the sockets.\n");
+        fprintf(stream, "       By default, PEs stay where the launcher put them. -V 1 prints every PE's placement.\n");
+        fprintf(stream, "  -m : Set the largest message size of the collective sweep to MAX_BYTES {%d..%d}.\n", COLL_BYTES_MIN, COLL_MAX_BYTES_MAX);
+        fprintf(stream, "       By default, the value of MAX_BYTES is %d.\n", COLL_MAX_BYTES_DEFAULT);
+        fprintf(stream, "  -e : Check the result of the collective once per message size before timing it.\n");
+        fprintf(stream, "  -K : Read hardware counters {cycles, instructions, llc-misses, branch-misses, context-switches} around\n");
+        fprintf(stream, "       the timed loop with perf_event_open and report them per call.\n");
+        fprintf(stream, "  -S, --scale-sweep : Run FUNC on PEs 0..P-1 for P = 2, 4, 8, ..., #PEs within this launch,\n");
+        fprintf(stream, "       print one row per P and fit latency = a + b * log2(P).\n");
         fprintf(stream, "  -h : Print this help.\n");
         fprintf(stream, "  -v : Print version info.\n");
         fprintf(stream, "  -V : Set verbosity level {0=low, 1, 2=high}.\n");
@@ -128,10 +266,18 @@ void print_version(FILE *stream, int my_pe)
     }
 }
 
-int process_args(FILE* stream, int argc, char *argv[], int my_pe, int* iterations, int* skip, void (**func_ptr)(void), char* func_name, int* verbosity_level)
+int process_args(FILE* stream, int argc, char *argv[], int my_pe, int* iterations, int* skip, void (**func_ptr)(void), char* func_name, int* verbosity_level, timer_kind_t* timer, int* radix,
+                 int* scale_sweep, affinity_t* affinity, const collective_t** collective, size_t* max_bytes, int* check,
+                 int* counters)
 {
     int c;
-    while ((c = getopt(argc, argv, ":vi:s:f:V:")) != -1)
+    const sync_algorithm_t *algo;
+    const collective_t *coll;
+    static const struct option long_options[] = {
+        { "scale-sweep", no_argument, NULL, 'S' },
+        { NULL, 0, NULL, 0 }
+    };
+    while ((c = getopt_long(argc, argv, ":vSeKi:s:f:V:T:r:a:m:", long_options, NULL)) != -1)
     {
         switch (c)
         {
@@ -148,16 +294,62 @@ int process_args(FILE* stream, int argc, char *argv[], int my_pe, int* iteration
                 *func_ptr = &empty_func;
                 strcpy(func_name, "empty_func");
             }
+            else if ((algo = sync_algorithm_find(optarg)) != NULL) {
+                *func_ptr = algo->func_ptr;
+                strcpy(func_name, algo->name);
+            }
+            else if ((coll = collective_find(optarg)) != NULL) {
+                *func_ptr = coll->func_ptr;
+                strcpy(func_name, coll->name);
+                *collective = coll;
+            }
             else {
                 print_usage(stream, argv[0], my_pe);
                 return 1;
             }
             break;
 
+        case 'T':
+            if (timer_parse(optarg, timer))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
         case 'v':
             print_version(stream, my_pe);
             return 1;
 
+        case 'S':
+            *scale_sweep = 1;
+            break;
+
+        case 'm':
+            *max_bytes = (size_t)atol(optarg);
+            if (*max_bytes < COLL_BYTES_MIN || *max_bytes > COLL_MAX_BYTES_MAX)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'e':
+            *check = 1;
+            break;
+
+        case 'K':
+            *counters = 1;
+            break;
+
+        case 'a':
+            if (affinity_parse(optarg, affinity))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
         case 'V':
             *verbosity_level = atoi(optarg);
             if (*verbosity_level < 0 || *verbosity_level > 2)
@@ -167,6 +359,15 @@ int process_args(FILE* stream, int argc, char *argv[], int my_pe, int* iteration
             }
             break;
 
+        case 'r':
+            *radix = atoi(optarg);
+            if (*radix < 2 || *radix > SYNC_RADIX_MAX)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
         case 's':
             *skip = atoi(optarg);
             if (*skip < 0)
@@ -195,36 +396,94 @@ int process_args(FILE* stream, int argc, char *argv[], int my_pe, int* iteration
 
 int main(int argc, char *argv[])
 {
-    static double min_avg, max_avg;
-    static double global_avg = 0, local_avg=0;
+    static data_t avg;
+    static data_t perf_counters[2 * PERF_EVENTS_MAX];
     int verbosity_level = 0, iterations = ITERATIONS_DEFAULT, skip = SKIP_DEFAULT;
-    int my_pe, num_pes, i;
+    int my_pe, num_pes;
+    int radix = SYNC_RADIX_DEFAULT, scale_sweep = 0;
+    timer_kind_t timer = TIMER_RDTSC;
     FILE *stream = stdout;
     void (*func_ptr)(void) = &shmem_sync_all;
     char func_name[30] = "shmem_sync_all";
+    affinity_t affinity;
+    placement_t *placements;
+    const collective_t *collective = NULL;
+    size_t max_bytes = COLL_MAX_BYTES_DEFAULT;
+    int check = 0, counters = 0, e;
+    perf_t perf;
     
-    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i += 1){
-        pSyncRed1[i] = _SHMEM_SYNC_VALUE;
-        pSyncRed2[i] = _SHMEM_SYNC_VALUE;
-    }
+    affinity.kind = AFFINITY_NONE;
     shmem_init();
     my_pe = shmem_my_pe();
     num_pes = shmem_n_pes();
 
-    if (process_args(stream, argc, argv, my_pe, &iterations, &skip, &func_ptr, func_name, &verbosity_level) != 0){
+    if (process_args(stream, argc, argv, my_pe, &iterations, &skip, &func_ptr, func_name, &verbosity_level, &timer, &radix, &scale_sweep, &affinity,
+                     &collective, &max_bytes, &check, &counters) != 0){
         shmem_finalize();
         return 0;
     }        
-    run_local_avg_latency_benchmark(func_ptr, iterations, skip, &local_avg);
+    if (timer_init(timer) && my_pe == 0)
+        fprintf(stream, "# Warning: no invariant cycle counter, falling back to %s timer.\n", bench_timer.name);
+    placements = (placement_t *)malloc(num_pes * sizeof(placement_t));
+    if (!placements || affinity_init(&affinity, placements))
+    {
+        fprintf(stream, "[%2d/%2d]: Pinning failed!\n", my_pe, num_pes);
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
+    affinity_print_info(stream, my_pe, num_pes, &affinity, placements, verbosity_level);
+    free(placements);
+    if (sync_algorithms_init(radix) || stats_init())
+    {
+        fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
+    if (collective)
+    {
+        if (collectives_init(collective, max_bytes))
+            fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+        else
+            run_collective_sweep(stream, my_pe, num_pes, collective, max_bytes, check, iterations, skip);
+        collectives_finalize();
+        stats_finalize();
+        sync_algorithms_finalize();
+        shmem_finalize();
+        return 0;
+    }
+    if (scale_sweep)
+    {
+        run_scale_sweep(stream, my_pe, num_pes, func_ptr, func_name, iterations, skip);
+        stats_finalize();
+        sync_algorithms_finalize();
+        shmem_finalize();
+        return 0;
+    }
+    if (counters && perf_init(&perf, 0))
+    {
+        fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
+    run_local_avg_latency_benchmark(func_ptr, &shmem_barrier_all, iterations, skip, &(avg.local), counters ? &perf : NULL);
+    stats_reduce(&avg, 1, num_pes);
 
-    shmem_barrier_all();
-    shmem_double_min_to_all(&min_avg,    &local_avg, 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-    shmem_double_max_to_all(&max_avg,    &local_avg, 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-    shmem_double_sum_to_all(&global_avg, &local_avg, 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-    global_avg /= num_pes;
+    print_results(stream, verbosity_level, my_pe, iterations, skip, num_pes, &avg, func_name);
 
-    print_results(stream, verbosity_level, my_pe, iterations, skip, num_pes, &global_avg, &min_avg, &max_avg, func_name);
+    if (counters)
+    {
+        for (e = 0; e < PERF_EVENTS_MAX; e++)
+        {
+            perf_counters[e].local = perf_delta(&perf, e) / iterations;
+            perf_counters[PERF_EVENTS_MAX + e].local = perf_available(&perf, e);
+        }
+        stats_reduce(perf_counters, 2 * PERF_EVENTS_MAX, num_pes);
+        print_perf_results(stream, my_pe, &perf, perf_counters);
+        perf_destroy(&perf);
+    }
 
+    stats_finalize();
+    sync_algorithms_finalize();
     shmem_finalize();
     return 0;
 }
@@ -0,0 +1,71 @@
+#ifndef OSHMEM_BENCH_ADAPTIVE_H
+#define OSHMEM_BENCH_ADAPTIVE_H
+
+#include <stdio.h>
+#include <string.h>
+
+#define ADAPTIVE_BATCH_SIZE             (1000)
+#define ADAPTIVE_MIN_BATCHES            (8)
+#define ADAPTIVE_MAX_WARMUP_BATCHES     (64)
+#define ADAPTIVE_BUDGET_DEFAULT         (60.0)
+#define ADAPTIVE_Z                      (1.96)
+
+// Adaptive iteration control. Instead of fixed ITER/SKIP the benchmark runs batches of ADAPTIVE_BATCH_SIZE:
+// warm-up lasts until a change-point test on the batch means says the series has settled, then batches are
+// recorded until the 95% confidence interval of every requested percentile on every PE is narrower than
+// target (relative to the percentile), or budget_sec of wall time have passed.
+typedef struct adaptive{
+    double target, budget_sec;
+    int warmup_batches;         // batches run before recording started
+    int warmup_end;             // batch at which the detected transient ended, max over PEs
+    int batches;                // recorded batches
+    int converged;              // 0 if the time budget ran out first
+    double elapsed_sec;
+}adaptive_t;
+
+// -A WIDTH[:BUDGET_SEC]
+static inline int adaptive_parse(const char *str, adaptive_t *adaptive)
+{
+    memset(adaptive, 0, sizeof(*adaptive));
+    adaptive->budget_sec = ADAPTIVE_BUDGET_DEFAULT;
+    if (sscanf(str, "%lf:%lf", &adaptive->target, &adaptive->budget_sec) < 1 ||
+        adaptive->target <= 0 || adaptive->budget_sec <= 0)
+        return -1;
+    return 0;
+}
+
+// MSER truncation point of a series: the number of leading batches d <= n/2 whose removal minimizes the
+// squared standard error of the mean of the rest, S(d) / (n - d)^2. An initial transient inflates S(d)
+// until it is cut off, so d lands where the series stops drifting.
+static inline int adaptive_mser(const double *means, int n)
+{
+    double best = -1, mean, sse;
+    int d, i, best_d = 0;
+    for (d = 0; d <= n / 2; d++)
+    {
+        mean = sse = 0;
+        for (i = d; i < n; i++)
+            mean += means[i];
+        mean /= (n - d);
+        for (i = d; i < n; i++)
+            sse += (means[i] - mean) * (means[i] - mean);
+        sse /= (double)(n - d) * (n - d);
+        if (best < 0 || sse < best) {
+            best = sse;
+            best_d = d;
+        }
+    }
+    return best_d;
+}
+
+// Warm-up is over once the transient is confined to the first quarter of the batches, so that at least
+// three quarters of the series look stationary; after ADAPTIVE_MAX_WARMUP_BATCHES it is declared over anyway.
+static inline int adaptive_warmed_up(const double *means, int n, int *warmup_end)
+{
+    *warmup_end = adaptive_mser(means, n);
+    if (n >= ADAPTIVE_MAX_WARMUP_BATCHES)
+        return 1;
+    return (n >= ADAPTIVE_MIN_BATCHES && *warmup_end <= n / 4);
+}
+
+#endif /* OSHMEM_BENCH_ADAPTIVE_H */
@@ -0,0 +1,258 @@
+#ifndef OSHMEM_BENCH_AFFINITY_H
+#define OSHMEM_BENCH_AFFINITY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sched.h>
+#include <shmem.h>
+
+#define HOSTNAME_SIZE                   (64)
+#define AFFINITY_LIST_MAX               (1024)
+#define AFFINITY_CACHE_INDEX_MAX        (16)
+
+// Optional pinning of every PE to a single CPU, by its rank among the PEs on the same host:
+//   compact  : fill one socket after the other
+//   scatter  : round-robin over the sockets
+//   list:L   : the comma-separated CPU list L, wrapping around when there are more PEs than entries
+// Only CPUs of the PE's current affinity mask are used, so launcher cpusets are respected.
+typedef enum affinity_kind{
+    AFFINITY_NONE = 0,
+    AFFINITY_COMPACT,
+    AFFINITY_SCATTER,
+    AFFINITY_LIST
+}affinity_kind_t;
+
+typedef struct affinity{
+    affinity_kind_t kind;
+    char name[30];
+    int list[AFFINITY_LIST_MAX];
+    int list_size;
+}affinity_t;
+
+// Where a PE runs. host is the lowest PE on the same host; -1 marks what sysfs doesn't tell.
+typedef struct placement{
+    int host, cpu, socket, numa, l3;
+}placement_t;
+
+// How far apart two PEs are, from closest to farthest
+typedef enum placement_class{
+    PLACEMENT_SAME_L3 = 0,
+    PLACEMENT_SAME_SOCKET,
+    PLACEMENT_CROSS_SOCKET,
+    PLACEMENT_CROSS_NODE,
+    PLACEMENT_CLASSES
+}placement_class_t;
+
+static const char* placement_class_names[PLACEMENT_CLASSES] = {
+    "same-L3", "same-socket", "cross-socket", "cross-node"
+};
+
+static inline int affinity_parse(const char *str, affinity_t *affinity)
+{
+    char temp_str[4096];
+    char *temp_ptr;
+    memset(affinity, 0, sizeof(*affinity));
+    if (strcmp(str, "compact") == 0)
+        affinity->kind = AFFINITY_COMPACT;
+    else if (strcmp(str, "scatter") == 0)
+        affinity->kind = AFFINITY_SCATTER;
+    else if (strncmp(str, "list:", 5) == 0) {
+        affinity->kind = AFFINITY_LIST;
+        strncpy(temp_str, str + 5, sizeof(temp_str) - 1);
+        temp_str[sizeof(temp_str) - 1] = '\0';
+        for (temp_ptr = strtok(temp_str, ","); temp_ptr && affinity->list_size < AFFINITY_LIST_MAX; temp_ptr = strtok(NULL, ",")) {
+            affinity->list[affinity->list_size] = atoi(temp_ptr);
+            if (affinity->list[affinity->list_size] < 0 || affinity->list[affinity->list_size] >= CPU_SETSIZE)
+                return -1;
+            affinity->list_size++;
+        }
+        if (affinity->list_size == 0)
+            return -1;
+    }
+    else
+        return -1;
+    strncpy(affinity->name, str, sizeof(affinity->name) - 1);
+    return 0;
+}
+
+static inline int topology_read_int(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    int value = -1;
+    if (file) {
+        if (fscanf(file, "%d", &value) != 1)
+            value = -1;
+        fclose(file);
+    }
+    return value;
+}
+
+// Socket, NUMA node and L3 domain of cpu from sysfs. The L3 domain is the cache id, or the first CPU
+// sharing the cache on kernels without cache ids.
+static inline void topology_of_cpu(int cpu, placement_t *placement)
+{
+    char path[256];
+    struct dirent *entry;
+    DIR *dir;
+    int index;
+
+    placement->cpu = cpu;
+    placement->numa = placement->l3 = -1;
+    sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    placement->socket = topology_read_int(path);
+    sprintf(path, "/sys/devices/system/cpu/cpu%d", cpu);
+    if ((dir = opendir(path)) != NULL) {
+        while ((entry = readdir(dir)) != NULL)
+            if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+                placement->numa = atoi(entry->d_name + 4);
+        closedir(dir);
+    }
+    for (index = 0; index < AFFINITY_CACHE_INDEX_MAX; index++) {
+        sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+        if (topology_read_int(path) != 3)
+            continue;
+        sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/id", cpu, index);
+        if ((placement->l3 = topology_read_int(path)) < 0) {
+            sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+            placement->l3 = topology_read_int(path);
+        }
+        break;
+    }
+}
+
+// The CPU for the local_rank-th PE of the host, or -1 if there is nothing to choose from.
+static inline int affinity_select_cpu(const affinity_t *affinity, int local_rank)
+{
+    int cpus[CPU_SETSIZE], sockets[CPU_SETSIZE], order[CPU_SETSIZE];
+    int ncpus = 0, cpu, i, j, tmp;
+    cpu_set_t set;
+
+    if (affinity->kind == AFFINITY_LIST)
+        return affinity->list[local_rank % affinity->list_size];
+    if (sched_getaffinity(0, sizeof(set), &set))
+        return -1;
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &set)) {
+            char path[256];
+            sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+            cpus[ncpus] = cpu;
+            sockets[ncpus] = topology_read_int(path);
+            ncpus++;
+        }
+    if (ncpus == 0)
+        return -1;
+
+    // Sort key: compact is (socket, cpu); scatter is (position within the socket, socket)
+    for (i = 0; i < ncpus; i++) {
+        order[i] = 0;
+        for (j = 0; j < i; j++)
+            order[i] += (sockets[j] == sockets[i]);
+    }
+    for (i = 1; i < ncpus; i++)
+        for (j = i; j > 0; j--) {
+            int swap = (affinity->kind == AFFINITY_SCATTER)
+                ? (order[j - 1] > order[j] || (order[j - 1] == order[j] && sockets[j - 1] > sockets[j]))
+                : (sockets[j - 1] > sockets[j]);
+            if (!swap)
+                break;
+            tmp = cpus[j];    cpus[j] = cpus[j - 1];       cpus[j - 1] = tmp;
+            tmp = sockets[j]; sockets[j] = sockets[j - 1]; sockets[j - 1] = tmp;
+            tmp = order[j];   order[j] = order[j - 1];     order[j - 1] = tmp;
+        }
+    return cpus[local_rank % ncpus];
+}
+
+// Collective over all PEs. Pins this PE as requested (AFFINITY_NONE leaves it where it is), then gathers
+// every PE's placement into placements[num_pes]. Returns -1 on allocation or pinning failure.
+static inline int affinity_init(const affinity_t *affinity, placement_t *placements)
+{
+    static long pSync[_SHMEM_COLLECT_SYNC_SIZE];
+    int my_pe = shmem_my_pe(), num_pes = shmem_n_pes();
+    char *hostname, *hostnames;
+    int *packed, *all;
+    int pe, local_rank = 0, host = my_pe, cpu, retval = 0;
+    cpu_set_t set;
+
+    for (pe = 0; pe < _SHMEM_COLLECT_SYNC_SIZE; pe++)
+        pSync[pe] = _SHMEM_SYNC_VALUE;
+    hostname = (char *)shmem_malloc(HOSTNAME_SIZE);
+    hostnames = (char *)shmem_malloc((size_t)num_pes * HOSTNAME_SIZE);
+    packed = (int *)shmem_malloc(sizeof(placement_t));
+    all = (int *)shmem_malloc((size_t)num_pes * sizeof(placement_t));
+    if (!hostname || !hostnames || !packed || !all) {
+        retval = -1;
+        goto out;
+    }
+    memset(hostname, 0, HOSTNAME_SIZE);
+    gethostname(hostname, HOSTNAME_SIZE - 1);
+    shmem_barrier_all();
+    shmem_fcollect64(hostnames, hostname, HOSTNAME_SIZE / 8, 0, 0, num_pes, pSync);
+    for (pe = my_pe - 1; pe >= 0; pe--)
+        if (strcmp(hostnames + (size_t)pe * HOSTNAME_SIZE, hostname) == 0) {
+            local_rank++;
+            host = pe;
+        }
+
+    if (affinity->kind != AFFINITY_NONE) {
+        if ((cpu = affinity_select_cpu(affinity, local_rank)) < 0)
+            retval = -1;
+        else {
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (sched_setaffinity(0, sizeof(set), &set))
+                retval = -1;
+        }
+    }
+    topology_of_cpu(sched_getcpu(), (placement_t *)packed);
+    ((placement_t *)packed)->host = host;
+
+    shmem_barrier_all();
+    shmem_fcollect32(all, packed, sizeof(placement_t) / sizeof(int), 0, 0, num_pes, pSync);
+    memcpy(placements, all, (size_t)num_pes * sizeof(placement_t));
+
+out:
+    shmem_barrier_all();
+    shmem_free(all);
+    shmem_free(packed);
+    shmem_free(hostnames);
+    shmem_free(hostname);
+    return retval;
+}
+
+static inline placement_class_t placement_class(const placement_t *a, const placement_t *b)
+{
+    if (a->host != b->host)
+        return PLACEMENT_CROSS_NODE;
+    if (a->socket != b->socket)
+        return PLACEMENT_CROSS_SOCKET;
+    if (a->l3 != b->l3)
+        return PLACEMENT_SAME_SOCKET;
+    return PLACEMENT_SAME_L3;
+}
+
+// Summary on PE 0: the pinning, how many PEs span how many hosts, and the farthest class the job spans.
+// From verbosity level 1 on, one line per PE.
+static inline void affinity_print_info(FILE *stream, int my_pe, int num_pes, const affinity_t *affinity,
+                                       const placement_t *placements, int verbosity_level)
+{
+    placement_class_t span = PLACEMENT_SAME_L3, c;
+    int pe, hosts = 0;
+    if (my_pe != 0)
+        return;
+    for (pe = 0; pe < num_pes; pe++) {
+        hosts += (placements[pe].host == pe);
+        c = placement_class(&placements[0], &placements[pe]);
+        span = (c > span) ? c : span;
+    }
+    fprintf(stream, "# Affinity: %s, %d PEs on %d hosts, spanning %s\n",
+            (affinity->kind == AFFINITY_NONE) ? "as launched" : affinity->name, num_pes, hosts, placement_class_names[span]);
+    if (verbosity_level >= 1)
+        for (pe = 0; pe < num_pes; pe++)
+            fprintf(stream, "# [%4d/%4d]: host PE %d, CPU %d, socket %d, NUMA %d, L3 %d\n", pe, num_pes, placements[pe].host,
+                    placements[pe].cpu, placements[pe].socket, placements[pe].numa, placements[pe].l3);
+}
+
+#endif /* OSHMEM_BENCH_AFFINITY_H */
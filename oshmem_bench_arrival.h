@@ -0,0 +1,276 @@
+#ifndef OSHMEM_BENCH_ARRIVAL_H
+#define OSHMEM_BENCH_ARRIVAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shmem.h>
+#include "oshmem_bench_timer.h"
+#include "oshmem_bench_histogram.h"
+
+#define ARRIVAL_CHUNK_SIZE              (4096)
+#define ARRIVAL_TRACE_VALUES_MAX        (1 << 20)
+#define ARRIVAL_LINE_MAX                (65536)
+
+// How the PEs reach every timed call:
+//   aligned        : shmem_barrier_all right before the call (the default)
+//   back-to-back   : pipelined, nothing in between
+//   gap:USEC       : every PE busy-waits USEC between two calls, no barrier
+//   random:USEC    : a barrier, then every PE busy-waits a uniform draw from [0, USEC), its own per iteration
+//   trace:FILE     : a barrier, then PE p busy-waits the offset in column p % #columns of the next row of FILE,
+//                    in usec; rows are iterations and are replayed cyclically, '#' starts a comment
+// The busy waits are outside the timed region.
+//
+// Exits of a sync are close to simultaneous, so in every iteration the earliest arriving PE sees the
+// longest latency and the latest arriving PE the shortest one. Per-iteration latencies are buffered
+// in chunks and reduced with one max and one min reduction per chunk into the latency histograms of
+// the earliest and the latest arrival.
+typedef enum arrival_kind{
+    ARRIVAL_ALIGNED = 0,
+    ARRIVAL_BACK_TO_BACK,
+    ARRIVAL_GAP,
+    ARRIVAL_RANDOM,
+    ARRIVAL_TRACE
+}arrival_kind_t;
+
+typedef struct arrival{
+    arrival_kind_t kind;
+    char name[60];
+    char path[256];
+    double usec;
+    uint64_t rng;
+    double *trace;              // symmetric, rows * cols offsets in usec
+    long *dims;                 // symmetric, rows and cols of the trace
+    int rows, cols, row, my_pe;
+    double *latencies, *earliest_ns, *latest_ns;    // symmetric [ARRIVAL_CHUNK_SIZE]
+    double *pWrk1, *pWrk2;
+    long *pSync1, *pSync2;
+    int count;
+    histogram_t earliest, latest;
+    double earliest_usec, latest_usec;  // sums of the recorded latencies
+    long recorded;
+}arrival_t;
+
+static arrival_t bench_arrival;
+
+static inline int arrival_parse(const char *str, arrival_t *arrival)
+{
+    memset(arrival, 0, sizeof(*arrival));
+    if (strcmp(str, "aligned") == 0)
+        arrival->kind = ARRIVAL_ALIGNED;
+    else if (strcmp(str, "back-to-back") == 0)
+        arrival->kind = ARRIVAL_BACK_TO_BACK;
+    else if (sscanf(str, "gap:%lf", &arrival->usec) == 1)
+        arrival->kind = ARRIVAL_GAP;
+    else if (sscanf(str, "random:%lf", &arrival->usec) == 1)
+        arrival->kind = ARRIVAL_RANDOM;
+    else if (sscanf(str, "trace:%255s", arrival->path) == 1)
+        arrival->kind = ARRIVAL_TRACE;
+    else
+        return -1;
+    if (arrival->usec < 0)
+        return -1;
+    strncpy(arrival->name, str, sizeof(arrival->name) - 1);
+    return 0;
+}
+
+// Reads the trace file into values, row by row. Returns the number of values, -1 on a bad file.
+static inline long arrival_read_trace(arrival_t *arrival, double *values)
+{
+    char line[ARRIVAL_LINE_MAX], *token, *end;
+    long n = 0;
+    int cols;
+    FILE *file = fopen(arrival->path, "r");
+    if (!file)
+        return -1;
+    arrival->rows = arrival->cols = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        if ((token = strchr(line, '#')) != NULL)
+            *token = '\0';
+        cols = 0;
+        for (token = strtok(line, " \t\r\n,"); token; token = strtok(NULL, " \t\r\n,"))
+        {
+            if (n >= ARRIVAL_TRACE_VALUES_MAX || (values[n] = strtod(token, &end)) < 0 || *end != '\0') {
+                fclose(file);
+                return -1;
+            }
+            n++;
+            cols++;
+        }
+        if (cols == 0)
+            continue;
+        if (arrival->cols && cols != arrival->cols) {
+            fclose(file);
+            return -1;
+        }
+        arrival->cols = cols;
+        arrival->rows++;
+    }
+    fclose(file);
+    return (n > 0) ? n : -1;
+}
+
+// Collective over all PEs: nonzero if failed is nonzero on any PE.
+static inline int arrival_any_failed(int failed)
+{
+    static long pSync[_SHMEM_REDUCE_SYNC_SIZE];
+    static int pWrk[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static int local, global;
+    int i;
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i++)
+        pSync[i] = _SHMEM_SYNC_VALUE;
+    local = failed;
+    shmem_barrier_all();
+    shmem_int_max_to_all(&global, &local, 1, 0, 0, shmem_n_pes(), pWrk, pSync);
+    return global;
+}
+
+// Collective over all PEs, has to be called after timer_init(). Only PE 0 reads the trace; the others fetch it
+// from there. Returns -1 on every PE on a bad trace or if the allocation failed on any PE.
+static inline int arrival_init(arrival_t *arrival, int my_pe, int significant_digits)
+{
+    size_t wrk_size = ARRIVAL_CHUNK_SIZE / 2 + 1;
+    double *values = NULL;
+    int i, failed;
+
+    if (wrk_size < _SHMEM_REDUCE_MIN_WRKDATA_SIZE)
+        wrk_size = _SHMEM_REDUCE_MIN_WRKDATA_SIZE;
+    arrival->my_pe = my_pe;
+    arrival->rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(my_pe + 1);
+    arrival->latencies   = (double *)shmem_malloc(ARRIVAL_CHUNK_SIZE * sizeof(double));
+    arrival->earliest_ns = (double *)shmem_malloc(ARRIVAL_CHUNK_SIZE * sizeof(double));
+    arrival->latest_ns   = (double *)shmem_malloc(ARRIVAL_CHUNK_SIZE * sizeof(double));
+    arrival->pWrk1  = (double *)shmem_malloc(wrk_size * sizeof(double));
+    arrival->pWrk2  = (double *)shmem_malloc(wrk_size * sizeof(double));
+    arrival->pSync1 = (long *)shmem_malloc(_SHMEM_REDUCE_SYNC_SIZE * sizeof(long));
+    arrival->pSync2 = (long *)shmem_malloc(_SHMEM_REDUCE_SYNC_SIZE * sizeof(long));
+    arrival->dims   = (long *)shmem_malloc(2 * sizeof(long));
+    failed = (!arrival->latencies || !arrival->earliest_ns || !arrival->latest_ns || !arrival->pWrk1 || !arrival->pWrk2 ||
+              !arrival->pSync1 || !arrival->pSync2 || !arrival->dims ||
+              histogram_init(&arrival->earliest, HISTOGRAM_HIGHEST_NSEC, significant_digits) ||
+              histogram_init(&arrival->latest, HISTOGRAM_HIGHEST_NSEC, significant_digits));
+    // A PE that couldn't allocate must not leave the others waiting in the collectives below
+    if (arrival_any_failed(failed))
+        return -1;
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i++) {
+        arrival->pSync1[i] = _SHMEM_SYNC_VALUE;
+        arrival->pSync2[i] = _SHMEM_SYNC_VALUE;
+    }
+
+    if (arrival->kind == ARRIVAL_TRACE)
+    {
+        arrival->dims[0] = arrival->dims[1] = 0;
+        if (my_pe == 0 && (values = (double *)malloc(ARRIVAL_TRACE_VALUES_MAX * sizeof(double))) != NULL &&
+            arrival_read_trace(arrival, values) > 0) {
+            arrival->dims[0] = arrival->rows;
+            arrival->dims[1] = arrival->cols;
+        }
+        shmem_barrier_all();
+        shmem_long_get(arrival->dims, arrival->dims, 2, 0);
+        arrival->rows = (int)arrival->dims[0];
+        arrival->cols = (int)arrival->dims[1];
+        if (arrival->rows == 0) {
+            free(values);
+            return -1;
+        }
+        arrival->trace = (double *)shmem_malloc((size_t)arrival->rows * arrival->cols * sizeof(double));
+        if (arrival_any_failed(!arrival->trace)) {
+            free(values);
+            return -1;
+        }
+        if (my_pe == 0)
+            memcpy(arrival->trace, values, (size_t)arrival->rows * arrival->cols * sizeof(double));
+        free(values);
+        shmem_barrier_all();
+        if (my_pe != 0)
+            shmem_double_get(arrival->trace, arrival->trace, (size_t)arrival->rows * arrival->cols, 0);
+    }
+    shmem_barrier_all();
+    return 0;
+}
+
+static inline void arrival_destroy(arrival_t *arrival)
+{
+    histogram_destroy(&arrival->latest);
+    histogram_destroy(&arrival->earliest);
+    shmem_barrier_all();
+    if (arrival->trace)
+        shmem_free(arrival->trace);
+    shmem_free(arrival->dims);
+    shmem_free(arrival->pSync2);
+    shmem_free(arrival->pSync1);
+    shmem_free(arrival->pWrk2);
+    shmem_free(arrival->pWrk1);
+    shmem_free(arrival->latest_ns);
+    shmem_free(arrival->earliest_ns);
+    shmem_free(arrival->latencies);
+}
+
+static inline void arrival_wait_usec(double usec)
+{
+    uint64_t t_start, ticks;
+    if (usec <= 0)
+        return;
+    ticks = (uint64_t)(usec * bench_timer.ticks_per_usec);
+    t_start = timer_read();
+    while (timer_read() - t_start < ticks)
+        ;
+}
+
+// pre_func of the arrival patterns, for bench_arrival.
+static inline void arrival_pre(void)
+{
+    arrival_t *arrival = &bench_arrival;
+    switch (arrival->kind)
+    {
+    case ARRIVAL_BACK_TO_BACK:
+        break;
+    case ARRIVAL_GAP:
+        arrival_wait_usec(arrival->usec);
+        break;
+    case ARRIVAL_RANDOM:
+        shmem_barrier_all();
+        arrival->rng ^= arrival->rng >> 12;
+        arrival->rng ^= arrival->rng << 25;
+        arrival->rng ^= arrival->rng >> 27;
+        arrival_wait_usec(arrival->usec * (((arrival->rng * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0)));
+        break;
+    case ARRIVAL_TRACE:
+        shmem_barrier_all();
+        arrival_wait_usec(arrival->trace[(size_t)arrival->row * arrival->cols + arrival->my_pe % arrival->cols]);
+        arrival->row = (arrival->row + 1) % arrival->rows;
+        break;
+    default:
+        shmem_barrier_all();
+    }
+}
+
+// Collective: every PE calls it after the same number of arrival_record() calls.
+static inline void arrival_flush(arrival_t *arrival)
+{
+    int num_pes = shmem_n_pes(), i;
+    if (arrival->count == 0)
+        return;
+    shmem_double_max_to_all(arrival->earliest_ns, arrival->latencies, arrival->count, 0, 0, num_pes, arrival->pWrk1, arrival->pSync1);
+    shmem_double_min_to_all(arrival->latest_ns  , arrival->latencies, arrival->count, 0, 0, num_pes, arrival->pWrk2, arrival->pSync2);
+    for (i = 0; i < arrival->count; i++)
+    {
+        histogram_record(&arrival->earliest, (int64_t)arrival->earliest_ns[i]);
+        histogram_record(&arrival->latest  , (int64_t)arrival->latest_ns[i]);
+        arrival->earliest_usec += arrival->earliest_ns[i] / 1000.0;
+        arrival->latest_usec   += arrival->latest_ns[i] / 1000.0;
+    }
+    arrival->recorded += arrival->count;
+    arrival->count = 0;
+}
+
+static inline void arrival_record(arrival_t *arrival, int64_t latency_ns)
+{
+    arrival->latencies[arrival->count] = (double)latency_ns;
+    if (++arrival->count == ARRIVAL_CHUNK_SIZE)
+        arrival_flush(arrival);
+}
+
+#endif /* OSHMEM_BENCH_ARRIVAL_H */
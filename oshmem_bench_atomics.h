@@ -0,0 +1,126 @@
+#ifndef OSHMEM_BENCH_ATOMICS_H
+#define OSHMEM_BENCH_ATOMICS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <shmem.h>
+
+#define ATOMIC_LINE_BYTES               (64)
+#define ATOMIC_LINE_LONGS               (ATOMIC_LINE_BYTES / sizeof(long))
+#define ATOMIC_WORDS_MAX                (1024)
+#define ATOMIC_CONTENDERS_MAX           (32)
+
+// Hot-spot contention on remote atomics: K contending PEs issue one atomic after the other, without anything
+// in between, on counters that live on a single target PE. With one word every contender hits the same
+// counter; with M words contender k uses word k % M, and the words sit on separate cache lines so that
+// sharding is not undone by false sharing. compare_swap increments like the other two, retrying with the
+// value it got back, so under contention part of its calls fail; the successful ones are counted.
+typedef struct atomic_state{
+    long *counters;         // symmetric, ATOMIC_WORDS_MAX cache lines, a counter at the start of each
+    long *counter;          // the counter this PE hits during a run
+    long expected;          // compare_swap: value the next swap expects
+    long swaps;             // compare_swap: successful swaps
+    int target, words;
+}atomic_state_t;
+
+typedef struct atomic_op{
+    const char *name;
+    void (*func_ptr)(void);
+}atomic_op_t;
+
+static atomic_state_t bench_atomic;
+
+static inline void atomic_fetch_add(void)
+{
+    (void)shmem_long_atomic_fetch_add(bench_atomic.counter, 1, bench_atomic.target);
+}
+
+static inline void atomic_fetch_inc(void)
+{
+    (void)shmem_long_atomic_fetch_inc(bench_atomic.counter, bench_atomic.target);
+}
+
+static inline void atomic_compare_swap(void)
+{
+    long old = shmem_long_atomic_compare_swap(bench_atomic.counter, bench_atomic.expected, bench_atomic.expected + 1,
+                                              bench_atomic.target);
+    if (old == bench_atomic.expected) {
+        bench_atomic.expected = old + 1;
+        bench_atomic.swaps++;
+    }
+    else
+        bench_atomic.expected = old;
+}
+
+static const atomic_op_t atomic_ops[] = {
+    { "fetch_add"   , &atomic_fetch_add },
+    { "fetch_inc"   , &atomic_fetch_inc },
+    { "compare_swap", &atomic_compare_swap },
+    { NULL, NULL }
+};
+
+static inline const atomic_op_t* atomic_op_find(const char *name)
+{
+    const atomic_op_t *op;
+    for (op = atomic_ops; op->name; op++)
+        if (strcmp(op->name, name) == 0)
+            return op;
+    return NULL;
+}
+
+// -H OP[:WORDS]
+static inline int atomic_parse(const char *str, const atomic_op_t **op, int *words)
+{
+    char name[32];
+    *words = 1;
+    if (sscanf(str, "%31[^:]:%d", name, words) < 1 || (*op = atomic_op_find(name)) == NULL ||
+        *words < 1 || *words > ATOMIC_WORDS_MAX)
+        return -1;
+    return 0;
+}
+
+// Collective over all PEs. The counters live on the last PE, so that the contenders are PEs 0..K-1.
+// Returns -1 on allocation failure.
+static inline int atomics_init(void)
+{
+    memset(&bench_atomic, 0, sizeof(bench_atomic));
+    bench_atomic.target = shmem_n_pes() - 1;
+    bench_atomic.counters = (long *)shmem_align(ATOMIC_LINE_BYTES, ATOMIC_WORDS_MAX * ATOMIC_LINE_BYTES);
+    if (!bench_atomic.counters)
+        return -1;
+    memset(bench_atomic.counters, 0, ATOMIC_WORDS_MAX * ATOMIC_LINE_BYTES);
+    shmem_barrier_all();
+    return 0;
+}
+
+static inline void atomics_finalize(void)
+{
+    shmem_barrier_all();
+    shmem_free(bench_atomic.counters);
+}
+
+// Fills contenders with the contender counts 1, 2, 4, ... up to every PE but the target; a single PE
+// contends with itself. Returns how many there are.
+static inline int atomics_contenders(int num_pes, int *contenders)
+{
+    int most = (num_pes > 1) ? num_pes - 1 : 1, k, n = 0;
+    for (k = 1; k < most; k *= 2)
+        contenders[n++] = k;
+    contenders[n++] = most;
+    return n;
+}
+
+// Collective over all PEs: clears the counters on the target and assigns this PE its word.
+static inline void atomics_reset(int words)
+{
+    shmem_barrier_all();
+    if (shmem_my_pe() == bench_atomic.target)
+        memset(bench_atomic.counters, 0, ATOMIC_WORDS_MAX * ATOMIC_LINE_BYTES);
+    bench_atomic.words = words;
+    bench_atomic.counter = bench_atomic.counters + (shmem_my_pe() % words) * ATOMIC_LINE_LONGS;
+    bench_atomic.expected = 0;
+    bench_atomic.swaps = 0;
+    shmem_barrier_all();
+}
+
+#endif /* OSHMEM_BENCH_ATOMICS_H */
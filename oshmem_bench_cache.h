@@ -0,0 +1,182 @@
+#ifndef OSHMEM_BENCH_CACHE_H
+#define OSHMEM_BENCH_CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <shmem.h>
+#include "oshmem_bench_timer.h"
+
+#define CACHE_LINE_BYTES                (64)
+#define CACHE_BYTES_FALLBACK            (64 * 1024 * 1024)
+#define CACHE_LEVELS_MAX                (8)
+#define CACHE_CALIBRATION_ROUNDS        (3)
+
+// Cache pollution between iterations, outside the timed region, standing in for the compute phase that
+// precedes a sync in an application:
+//   sweep[:BYTES]  : writes one word per cache line of a private BYTES buffer, evicting by capacity
+//   random[:BYTES] : chases a random cyclic permutation of the lines of the buffer with dependent loads,
+//                    which the prefetchers cannot follow and which also churns the TLB
+// By default, BYTES is twice the largest cache of the CPU the PE runs on, as sysfs reports it.
+// The pollution takes a different time on every PE. So that this doesn't turn into arrival skew at the
+// timed call, every PE holds back for release_ticks after the barrier that precedes the pollution, which
+// is twice the slowest pollution seen on any PE at init.
+typedef enum cache_kind{
+    CACHE_WARM = 0,
+    CACHE_SWEEP,
+    CACHE_RANDOM
+}cache_kind_t;
+
+typedef struct cache_pollution{
+    cache_kind_t kind;
+    char name[60];
+    size_t bytes;
+    char *buffer;
+    uint64_t release_ticks;
+    volatile size_t sink;
+}cache_pollution_t;
+
+static cache_pollution_t bench_cache;
+
+static inline int cache_parse(const char *str, cache_pollution_t *cache)
+{
+    char kind[16];
+    unsigned long long bytes = 0;
+    memset(cache, 0, sizeof(*cache));
+    if (sscanf(str, "%15[^:]:%llu", kind, &bytes) < 1)
+        return -1;
+    if (strcmp(kind, "sweep") == 0)
+        cache->kind = CACHE_SWEEP;
+    else if (strcmp(kind, "random") == 0)
+        cache->kind = CACHE_RANDOM;
+    else
+        return -1;
+    if (strchr(str, ':') && bytes < CACHE_LINE_BYTES)
+        return -1;
+    cache->bytes = (size_t)bytes;
+    strncpy(cache->name, str, sizeof(cache->name) - 1);
+    return 0;
+}
+
+// Size in bytes of the largest cache of cpu, 0 if sysfs doesn't tell.
+static inline size_t cache_largest_bytes(int cpu)
+{
+    char path[128];
+    size_t largest = 0, size;
+    char unit;
+    int index, n;
+    FILE *file;
+    for (index = 0; index < CACHE_LEVELS_MAX; index++)
+    {
+        sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/size", cpu, index);
+        if ((file = fopen(path, "r")) == NULL)
+            break;
+        unit = 0;
+        n = fscanf(file, "%zu%c", &size, &unit);
+        fclose(file);
+        if (n < 1)
+            continue;
+        size *= (unit == 'K') ? 1024 : (unit == 'M') ? 1024 * 1024 : (unit == 'G') ? 1024 * 1024 * 1024 : 1;
+        largest = (size > largest) ? size : largest;
+    }
+    return largest;
+}
+
+static inline void cache_pollute(cache_pollution_t *cache)
+{
+    size_t offset, line = 0, lines = cache->bytes / CACHE_LINE_BYTES, i;
+    if (cache->kind == CACHE_SWEEP)
+        for (offset = 0; offset < cache->bytes; offset += CACHE_LINE_BYTES)
+            cache->buffer[offset]++;
+    else if (cache->kind == CACHE_RANDOM) {
+        for (i = 0; i < lines; i++)
+            line = *(size_t *)(cache->buffer + line * CACHE_LINE_BYTES);
+        cache->sink = line;
+    }
+}
+
+// Collective over all PEs, has to be called after pinning and timer_init(). Returns -1 on allocation failure
+// on any PE.
+static inline int cache_init(cache_pollution_t *cache, int my_pe)
+{
+    static long pSync[_SHMEM_REDUCE_SYNC_SIZE];
+    static double pWrk[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static double local[2], global[2];
+    uint64_t t_start;
+    double ticks;
+    size_t lines, i, j, tmp, *order = NULL;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL * (my_pe + 1);
+    int cpu = sched_getcpu();
+
+    if (cache->bytes == 0) {
+        cache->bytes = 2 * cache_largest_bytes((cpu < 0) ? 0 : cpu);
+        if (cache->bytes == 0)
+            cache->bytes = CACHE_BYTES_FALLBACK;
+    }
+    cache->bytes -= cache->bytes % CACHE_LINE_BYTES;
+    lines = cache->bytes / CACHE_LINE_BYTES;
+    cache->buffer = (char *)malloc(cache->bytes);
+    if (cache->buffer && cache->kind == CACHE_RANDOM)
+        order = (size_t *)malloc(lines * sizeof(size_t));
+    local[0] = (!cache->buffer || (cache->kind == CACHE_RANDOM && !order));
+    local[1] = 0;
+
+    if (!local[0]) {
+        memset(cache->buffer, 0, cache->bytes);
+        if (cache->kind == CACHE_RANDOM) {
+            // Sattolo's shuffle gives a single cycle through all lines
+            for (i = 0; i < lines; i++)
+                order[i] = i;
+            for (i = lines - 1; i > 0; i--)
+            {
+                rng ^= rng >> 12;
+                rng ^= rng << 25;
+                rng ^= rng >> 27;
+                j = (size_t)((rng * 2685821657736338717ULL) % i);
+                tmp = order[i];
+                order[i] = order[j];
+                order[j] = tmp;
+            }
+            for (i = 0; i < lines; i++)
+                *(size_t *)(cache->buffer + order[i] * CACHE_LINE_BYTES) = order[(i + 1) % lines];
+        }
+        for (i = 0; i < CACHE_CALIBRATION_ROUNDS; i++)
+        {
+            t_start = timer_read();
+            cache_pollute(cache);
+            ticks = (double)(timer_read() - t_start);
+            local[1] = (ticks > local[1]) ? ticks : local[1];
+        }
+    }
+    free(order);
+
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i++)
+        pSync[i] = _SHMEM_SYNC_VALUE;
+    shmem_barrier_all();
+    shmem_double_max_to_all(global, local, 2, 0, 0, shmem_n_pes(), pWrk, pSync);
+    cache->release_ticks = (uint64_t)(2 * global[1]);
+    return global[0] ? -1 : 0;
+}
+
+static inline void cache_destroy(cache_pollution_t *cache)
+{
+    free(cache->buffer);
+    cache->buffer = NULL;
+}
+
+// pre_func of the cold runs. The PEs line up first and then pollute, as after a compute phase: a barrier
+// after the pollution would pull the library's sync state back into the cache right before the timed call.
+// The wait for the common release only spins on the timer and leaves the caches as the pollution left them.
+static inline void cache_barrier_pollute(void)
+{
+    uint64_t t_release;
+    shmem_barrier_all();
+    t_release = timer_read() + bench_cache.release_ticks;
+    cache_pollute(&bench_cache);
+    while (timer_read() < t_release)
+        ;
+}
+
+#endif /* OSHMEM_BENCH_CACHE_H */
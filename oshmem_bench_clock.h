@@ -0,0 +1,128 @@
+#ifndef OSHMEM_BENCH_CLOCK_H
+#define OSHMEM_BENCH_CLOCK_H
+
+#include <stdint.h>
+#include <shmem.h>
+#include "oshmem_bench_timer.h"
+
+#define CLOCK_SYNC_ROUNDS_DEFAULT       (100)
+
+// Maps PE-local time stamps onto PE 0's timeline.
+// Local clock minus PE 0 clock is modeled as offset_ns + drift * (local_ns - ref_ns),
+// where offset/ref come from the latest estimate and drift from the last two estimates.
+typedef struct clock_sync{
+    uint64_t base_ticks;
+    double offset_ns, ref_ns, drift;
+    double rtt_ns;
+    int estimates;
+}clock_sync_t;
+
+static clock_sync_t bench_clock;
+
+// Symmetric ping-pong state
+static long clock_ping, clock_pong, clock_seq;
+static double clock_pong_time;
+static double clock_result[3];
+
+// Nanoseconds since clock_sync_init() on this PE's clock.
+static inline double clock_local_ns(void)
+{
+    return timer_ticks_to_nsec(timer_read() - bench_clock.base_ticks);
+}
+
+static inline double clock_ticks_to_local_ns(uint64_t ticks)
+{
+    return timer_ticks_to_nsec(ticks - bench_clock.base_ticks);
+}
+
+static inline double clock_predicted_offset_ns(double local_ns)
+{
+    return bench_clock.offset_ns + bench_clock.drift * (local_ns - bench_clock.ref_ns);
+}
+
+static inline double clock_global_ns(double local_ns)
+{
+    return local_ns - clock_predicted_offset_ns(local_ns);
+}
+
+// Ping-pong between PE 0 and every other PE in turn; for each PE the round with the
+// smallest round-trip time wins, and the offset is taken against the midpoint of that round.
+// Collective over all PEs. Returns the offset of this PE against PE 0 and the local time it refers to.
+static inline void clock_estimate(int rounds, double *offset_ns, double *ref_ns, double *rtt_ns)
+{
+    int my_pe = shmem_my_pe(), num_pes = shmem_n_pes();
+    int pe, r;
+
+    *offset_ns = 0;
+    *ref_ns = clock_local_ns();
+    *rtt_ns = 0;
+    shmem_barrier_all();
+    for (pe = 1; pe < num_pes; pe++)
+    {
+        double best_rtt = __DBL_MAX__, best_offset = 0, best_ref = 0;
+        for (r = 0; r < rounds; r++)
+        {
+            clock_seq++;
+            if (my_pe == 0) {
+                double t0, t1;
+                t0 = clock_local_ns();
+                shmem_long_p(&clock_ping, clock_seq, pe);
+                shmem_long_wait_until(&clock_pong, SHMEM_CMP_EQ, clock_seq);
+                t1 = clock_local_ns();
+                if (t1 - t0 < best_rtt) {
+                    best_rtt = t1 - t0;
+                    best_offset = clock_pong_time - (t0 + t1) / 2;
+                    best_ref = clock_pong_time;
+                }
+            }
+            else if (my_pe == pe) {
+                shmem_long_wait_until(&clock_ping, SHMEM_CMP_EQ, clock_seq);
+                shmem_double_p(&clock_pong_time, clock_local_ns(), 0);
+                shmem_fence();
+                shmem_long_p(&clock_pong, clock_seq, 0);
+            }
+        }
+        if (my_pe == 0) {
+            double result[3] = { best_offset, best_ref, best_rtt };
+            shmem_double_put(clock_result, result, 3, pe);
+        }
+    }
+    shmem_barrier_all();
+    if (my_pe != 0) {
+        *offset_ns = clock_result[0];
+        *ref_ns = clock_result[1];
+        *rtt_ns = clock_result[2];
+    }
+}
+
+// Takes a new estimate and folds it into the model; from the second call on, drift is updated too.
+static inline void clock_sync_update(int rounds)
+{
+    double offset_ns, ref_ns, rtt_ns;
+    clock_estimate(rounds, &offset_ns, &ref_ns, &rtt_ns);
+    if (bench_clock.estimates > 0 && ref_ns > bench_clock.ref_ns)
+        bench_clock.drift = (offset_ns - bench_clock.offset_ns) / (ref_ns - bench_clock.ref_ns);
+    bench_clock.offset_ns = offset_ns;
+    bench_clock.ref_ns = ref_ns;
+    bench_clock.rtt_ns = rtt_ns;
+    bench_clock.estimates++;
+}
+
+// Collective. Has to be called after timer_init().
+static inline void clock_sync_init(int rounds)
+{
+    memset(&bench_clock, 0, sizeof(bench_clock));
+    bench_clock.base_ticks = timer_read();
+    clock_sync_update(rounds);
+}
+
+// Re-estimates the offset without touching the model and returns how far the model's prediction was off.
+static inline double clock_sync_error_ns(int rounds)
+{
+    double offset_ns, ref_ns, rtt_ns, error_ns;
+    clock_estimate(rounds, &offset_ns, &ref_ns, &rtt_ns);
+    error_ns = offset_ns - clock_predicted_offset_ns(ref_ns);
+    return (error_ns < 0) ? -error_ns : error_ns;
+}
+
+#endif /* OSHMEM_BENCH_CLOCK_H */
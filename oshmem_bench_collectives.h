@@ -0,0 +1,208 @@
+#ifndef OSHMEM_BENCH_COLLECTIVES_H
+#define OSHMEM_BENCH_COLLECTIVES_H
+
+#include <stdint.h>
+#include <string.h>
+#include <shmem.h>
+
+#define COLL_BYTES_MIN                  (8)
+#define COLL_MAX_BYTES_DEFAULT          (64 * 1024)
+#define COLL_MAX_BYTES_MAX              (8 * 1024 * 1024)
+#define COLL_ROOT                       (0)
+#define COLL_SIZES_MAX                  (32)
+
+// Data-carrying collectives over all PEs on 64-bit elements, for a message size set with collectives_set_size().
+// The size is what every PE contributes: the broadcast and the sum reduction move size bytes, fcollect and
+// alltoall size bytes per PE, so their destinations hold #PEs * size. Source and destination come from
+// shmem_malloc and are sized for the selected collective and the largest message up front: max_bytes each
+// for the broadcast and the reduction, #PEs * max_bytes for the fcollect destination and for both alltoall
+// buffers.
+//
+// Successive calls alternate between two pSync (and pWrk) sets, so that the all-to-all collectives can run
+// back to back without a barrier in between. A broadcast only depends on the root, which could run ahead
+// and reuse a pSync still in use elsewhere; back to back it is followed by a barrier on a pSync of its own.
+typedef struct collective_state{
+    int64_t *source, *dest;     // symmetric, source_blocks and dest_blocks times max_bytes
+    int source_blocks, dest_blocks;
+    double *pWrk[2];            // symmetric
+    long *pSync[2];             // symmetric, SHMEM_SYNC_SIZE each
+    long *pSync_barrier;        // symmetric
+    size_t max_bytes, nelems;
+    int my_pe, num_pes, parity;
+}collective_state_t;
+
+typedef struct collective{
+    const char *name;
+    void (*func_ptr)(void);         // one call, the caller lines the PEs up in between
+    void (*back_to_back_ptr)(void); // safe to call repeatedly without anything in between
+}collective_t;
+
+static collective_state_t bench_coll;
+
+static inline long* collectives_next_pSync(void)
+{
+    bench_coll.parity ^= 1;
+    return bench_coll.pSync[bench_coll.parity];
+}
+
+static inline void coll_broadcast(void)
+{
+    shmem_broadcast64(bench_coll.dest, bench_coll.source, bench_coll.nelems, COLL_ROOT, 0, 0, bench_coll.num_pes,
+                      collectives_next_pSync());
+}
+
+static inline void coll_broadcast_back_to_back(void)
+{
+    coll_broadcast();
+    shmem_barrier(0, 0, bench_coll.num_pes, bench_coll.pSync_barrier);
+}
+
+static inline void coll_sum_reduce(void)
+{
+    long *pSync = collectives_next_pSync();
+    shmem_double_sum_to_all((double *)bench_coll.dest, (double *)bench_coll.source, (int)bench_coll.nelems, 0, 0, bench_coll.num_pes,
+                            bench_coll.pWrk[bench_coll.parity], pSync);
+}
+
+static inline void coll_fcollect(void)
+{
+    shmem_fcollect64(bench_coll.dest, bench_coll.source, bench_coll.nelems, 0, 0, bench_coll.num_pes, collectives_next_pSync());
+}
+
+static inline void coll_alltoall(void)
+{
+    shmem_alltoall64(bench_coll.dest, bench_coll.source, bench_coll.nelems, 0, 0, bench_coll.num_pes, collectives_next_pSync());
+}
+
+static const collective_t collectives[] = {
+    { "broadcast" , &coll_broadcast , &coll_broadcast_back_to_back },
+    { "sum_reduce", &coll_sum_reduce, &coll_sum_reduce },
+    { "fcollect"  , &coll_fcollect  , &coll_fcollect },
+    { "alltoall"  , &coll_alltoall  , &coll_alltoall },
+    { NULL, NULL, NULL }
+};
+
+static inline const collective_t* collective_find(const char *name)
+{
+    const collective_t *coll;
+    for (coll = collectives; coll->name; coll++)
+        if (strcmp(coll->name, name) == 0)
+            return coll;
+    return NULL;
+}
+
+// Collective over all PEs, allocates for coll only. Returns -1 on every PE if the allocation failed on any of them.
+static inline int collectives_init(const collective_t *coll, size_t max_bytes)
+{
+    static long failed, any_failed;
+    static long pWrk_failed[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static long pSync_failed[_SHMEM_REDUCE_SYNC_SIZE];
+    size_t max_nelems = max_bytes / sizeof(int64_t);
+    size_t wrk_size = max_nelems / 2 + 1;
+    int i;
+
+    memset(&bench_coll, 0, sizeof(bench_coll));
+    if (wrk_size < _SHMEM_REDUCE_MIN_WRKDATA_SIZE)
+        wrk_size = _SHMEM_REDUCE_MIN_WRKDATA_SIZE;
+    bench_coll.my_pe = shmem_my_pe();
+    bench_coll.num_pes = shmem_n_pes();
+    bench_coll.max_bytes = max_bytes;
+    bench_coll.source_blocks = (coll->func_ptr == &coll_alltoall) ? bench_coll.num_pes : 1;
+    bench_coll.dest_blocks = (coll->func_ptr == &coll_alltoall || coll->func_ptr == &coll_fcollect) ? bench_coll.num_pes : 1;
+    bench_coll.source = (int64_t *)shmem_malloc(bench_coll.source_blocks * max_bytes);
+    bench_coll.dest = (int64_t *)shmem_malloc(bench_coll.dest_blocks * max_bytes);
+    bench_coll.pWrk[0] = (double *)shmem_malloc(wrk_size * sizeof(double));
+    bench_coll.pWrk[1] = (double *)shmem_malloc(wrk_size * sizeof(double));
+    bench_coll.pSync[0] = (long *)shmem_malloc(SHMEM_SYNC_SIZE * sizeof(long));
+    bench_coll.pSync[1] = (long *)shmem_malloc(SHMEM_SYNC_SIZE * sizeof(long));
+    bench_coll.pSync_barrier = (long *)shmem_malloc(_SHMEM_BARRIER_SYNC_SIZE * sizeof(long));
+    // A PE that couldn't allocate must not leave the others waiting in the sweep
+    failed = (!bench_coll.source || !bench_coll.dest || !bench_coll.pWrk[0] || !bench_coll.pWrk[1] ||
+              !bench_coll.pSync[0] || !bench_coll.pSync[1] || !bench_coll.pSync_barrier);
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i++)
+        pSync_failed[i] = _SHMEM_SYNC_VALUE;
+    shmem_barrier_all();
+    shmem_long_max_to_all(&any_failed, &failed, 1, 0, 0, bench_coll.num_pes, pWrk_failed, pSync_failed);
+    if (any_failed)
+        return -1;
+    for (i = 0; i < SHMEM_SYNC_SIZE; i++) {
+        bench_coll.pSync[0][i] = _SHMEM_SYNC_VALUE;
+        bench_coll.pSync[1][i] = _SHMEM_SYNC_VALUE;
+    }
+    for (i = 0; i < _SHMEM_BARRIER_SYNC_SIZE; i++)
+        bench_coll.pSync_barrier[i] = _SHMEM_SYNC_VALUE;
+    bench_coll.nelems = max_nelems;
+    shmem_barrier_all();
+    return 0;
+}
+
+static inline void collectives_finalize(void)
+{
+    shmem_barrier_all();
+    shmem_free(bench_coll.pSync_barrier);
+    shmem_free(bench_coll.pSync[1]);
+    shmem_free(bench_coll.pSync[0]);
+    shmem_free(bench_coll.pWrk[1]);
+    shmem_free(bench_coll.pWrk[0]);
+    shmem_free(bench_coll.dest);
+    shmem_free(bench_coll.source);
+}
+
+// Fills sizes with the power-of-two message sizes from COLL_BYTES_MIN to max_bytes; returns how many there are.
+static inline int collectives_sizes(size_t max_bytes, size_t *sizes)
+{
+    size_t bytes;
+    int n = 0;
+    for (bytes = COLL_BYTES_MIN; bytes <= max_bytes; bytes *= 2)
+        sizes[n++] = bytes;
+    return n;
+}
+
+static inline void collectives_set_size(size_t bytes)
+{
+    bench_coll.nelems = bytes / sizeof(int64_t);
+}
+
+// Element j of the block PE from sends to PE to
+static inline int64_t collectives_pattern(int from, int to, size_t j)
+{
+    return ((int64_t)from << 40) | ((int64_t)to << 20) | (int64_t)j;
+}
+
+// Collective over all PEs. Fills the sources with a pattern unique to sender, receiver and element, runs coll
+// once between barriers and verifies the destination. Returns the number of wrong elements on this PE.
+static inline long collectives_check(const collective_t *coll)
+{
+    size_t n = bench_coll.nelems, j;
+    int me = bench_coll.my_pe, num_pes = bench_coll.num_pes, pe;
+    double *dsource = (double *)bench_coll.source, *ddest = (double *)bench_coll.dest;
+    long errors = 0;
+
+    for (pe = 0; pe < bench_coll.source_blocks; pe++)
+        for (j = 0; j < n; j++) {
+            if (coll->func_ptr == &coll_sum_reduce)
+                dsource[pe * n + j] = (double)(me + j);
+            else
+                bench_coll.source[pe * n + j] = collectives_pattern(me, (coll->func_ptr == &coll_alltoall) ? pe : 0, j);
+        }
+    for (j = 0; j < bench_coll.dest_blocks * n; j++)
+        bench_coll.dest[j] = -1;
+    shmem_barrier_all();
+    coll->func_ptr();
+    shmem_barrier_all();
+
+    for (j = 0; j < n; j++) {
+        if (coll->func_ptr == &coll_broadcast)
+            errors += (me != COLL_ROOT && bench_coll.dest[j] != collectives_pattern(COLL_ROOT, 0, j));
+        else if (coll->func_ptr == &coll_sum_reduce)
+            errors += (ddest[j] != (double)num_pes * (num_pes - 1) / 2 + (double)num_pes * j);
+        else
+            for (pe = 0; pe < num_pes; pe++)
+                errors += (bench_coll.dest[pe * n + j] !=
+                           collectives_pattern(pe, (coll->func_ptr == &coll_alltoall) ? me : 0, j));
+    }
+    shmem_barrier_all();
+    return errors;
+}
+
+#endif /* OSHMEM_BENCH_COLLECTIVES_H */
@@ -0,0 +1,230 @@
+#ifndef OSHMEM_BENCH_COMPUTE_H
+#define OSHMEM_BENCH_COMPUTE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "oshmem_bench_timer.h"
+
+#define COMPUTE_STREAM_ELEMENTS         (2 * 1024 * 1024)
+#define COMPUTE_CHASE_LINES             (512 * 1024)
+#define COMPUTE_CACHE_LINE              (64)
+#define COMPUTE_FMA_LANES               (32)
+#define COMPUTE_CALIBRATION_NSEC        (2 * 1000 * 1000)
+
+// Compute kernels that stand in for the application work between syncs.
+// Each kernel does "amount" units of work; the unit cost is calibrated once per PE,
+// so a target duration can be turned into an amount with compute_amount_for_usec().
+//   spin   : dependent integer chain, pure core-bound busy work
+//   stream : STREAM triad over arrays far larger than the LLC, memory-bandwidth bound
+//   fma    : independent multiply-add chains the compiler can vectorize, FP-throughput bound
+//   chase  : dependent loads along a random cyclic permutation of cache lines, latency bound
+typedef enum compute_kind{
+    COMPUTE_SPIN = 0,
+    COMPUTE_STREAM,
+    COMPUTE_FMA,
+    COMPUTE_CHASE
+}compute_kind_t;
+
+typedef struct compute_kernel{
+    compute_kind_t kind;
+    char name[30];
+    double ns_per_unit;
+    double *a, *b, *c;
+    size_t stream_pos;
+    size_t *chase;
+    size_t chase_pos;
+    uint64_t spin_state;
+    double fma_acc[COMPUTE_FMA_LANES];
+}compute_kernel_t;
+
+static compute_kernel_t bench_compute;
+static volatile double compute_sink;
+
+static inline int compute_parse(const char *str, compute_kind_t *kind)
+{
+    if (strcmp(str, "spin") == 0)
+        *kind = COMPUTE_SPIN;
+    else if (strcmp(str, "stream") == 0)
+        *kind = COMPUTE_STREAM;
+    else if (strcmp(str, "fma") == 0)
+        *kind = COMPUTE_FMA;
+    else if (strcmp(str, "chase") == 0)
+        *kind = COMPUTE_CHASE;
+    else
+        return -1;
+    return 0;
+}
+
+static inline void compute_spin(long amount)
+{
+    uint64_t x = bench_compute.spin_state;
+    long i;
+    for (i = 0; i < amount; i++)
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    bench_compute.spin_state = x;
+    compute_sink = (double)x;
+}
+
+static inline void compute_stream(long amount)
+{
+    double *a = bench_compute.a, *b = bench_compute.b, *c = bench_compute.c;
+    size_t pos = bench_compute.stream_pos, i, end;
+    while (amount > 0)
+    {
+        end = pos + (size_t)amount;
+        if (end > COMPUTE_STREAM_ELEMENTS)
+            end = COMPUTE_STREAM_ELEMENTS;
+        for (i = pos; i < end; i++)
+            a[i] = b[i] + 3.0 * c[i];
+        amount -= (long)(end - pos);
+        pos = (end == COMPUTE_STREAM_ELEMENTS) ? 0 : end;
+    }
+    bench_compute.stream_pos = pos;
+    compute_sink = a[0];
+}
+
+static inline void compute_fma(long amount)
+{
+    double acc[COMPUTE_FMA_LANES];
+    long i;
+    int j;
+    memcpy(acc, bench_compute.fma_acc, sizeof(acc));
+    for (i = 0; i < amount; i++)
+        for (j = 0; j < COMPUTE_FMA_LANES; j++)
+            acc[j] = acc[j] * 0.999999 + 1e-6;
+    memcpy(bench_compute.fma_acc, acc, sizeof(acc));
+    compute_sink = acc[0];
+}
+
+static inline void compute_chase(long amount)
+{
+    size_t *chase = bench_compute.chase, pos = bench_compute.chase_pos;
+    long i;
+    for (i = 0; i < amount; i++)
+        pos = chase[pos];
+    bench_compute.chase_pos = pos;
+    compute_sink = (double)pos;
+}
+
+static inline void compute_run(long amount)
+{
+    switch (bench_compute.kind)
+    {
+    case COMPUTE_STREAM:
+        compute_stream(amount);
+        break;
+    case COMPUTE_FMA:
+        compute_fma(amount);
+        break;
+    case COMPUTE_CHASE:
+        compute_chase(amount);
+        break;
+    default:
+        compute_spin(amount);
+        break;
+    }
+}
+
+static inline long compute_amount_for_usec(double usec)
+{
+    return (long)(usec * 1000.0 / bench_compute.ns_per_unit + 0.5);
+}
+
+// Doubles the amount until one run takes at least COMPUTE_CALIBRATION_NSEC, then takes the best of 3 runs.
+static inline void compute_calibrate(void)
+{
+    uint64_t t_start, t_stop;
+    double best = __DBL_MAX__, elapsed;
+    long amount = 1;
+    int i;
+
+    for (;;) {
+        t_start = timer_read();
+        compute_run(amount);
+        t_stop = timer_read();
+        if (timer_ticks_to_nsec(t_stop - t_start) >= COMPUTE_CALIBRATION_NSEC)
+            break;
+        amount *= 2;
+    }
+    for (i = 0; i < 3; i++) {
+        t_start = timer_read();
+        compute_run(amount);
+        t_stop = timer_read();
+        elapsed = timer_ticks_to_nsec(t_stop - t_start);
+        best = (elapsed < best) ? elapsed : best;
+    }
+    bench_compute.ns_per_unit = best / (double)amount;
+}
+
+// Allocates the kernel's working set and calibrates it. Has to be called after timer_init().
+static inline int compute_init(compute_kind_t kind)
+{
+    size_t i, j, tmp;
+
+    memset(&bench_compute, 0, sizeof(bench_compute));
+    bench_compute.kind = kind;
+    bench_compute.spin_state = 1;
+    switch (kind)
+    {
+    case COMPUTE_STREAM:
+        strcpy(bench_compute.name, "stream");
+        bench_compute.a = (double *)malloc(COMPUTE_STREAM_ELEMENTS * sizeof(double));
+        bench_compute.b = (double *)malloc(COMPUTE_STREAM_ELEMENTS * sizeof(double));
+        bench_compute.c = (double *)malloc(COMPUTE_STREAM_ELEMENTS * sizeof(double));
+        if (!bench_compute.a || !bench_compute.b || !bench_compute.c)
+            return -1;
+        for (i = 0; i < COMPUTE_STREAM_ELEMENTS; i++) {
+            bench_compute.a[i] = 0;
+            bench_compute.b[i] = 1;
+            bench_compute.c[i] = 2;
+        }
+        break;
+    case COMPUTE_FMA:
+        strcpy(bench_compute.name, "fma");
+        for (i = 0; i < COMPUTE_FMA_LANES; i++)
+            bench_compute.fma_acc[i] = (double)i;
+        break;
+    case COMPUTE_CHASE:
+        strcpy(bench_compute.name, "chase");
+        // One index per cache line; the lines are shuffled and linked into a single cycle
+        bench_compute.chase = (size_t *)malloc(COMPUTE_CHASE_LINES * COMPUTE_CACHE_LINE);
+        if (!bench_compute.chase)
+            return -1;
+        {
+            size_t *order = (size_t *)malloc(COMPUTE_CHASE_LINES * sizeof(size_t));
+            const size_t stride = COMPUTE_CACHE_LINE / sizeof(size_t);
+            if (!order)
+                return -1;
+            for (i = 0; i < COMPUTE_CHASE_LINES; i++)
+                order[i] = i;
+            srand(1);
+            for (i = COMPUTE_CHASE_LINES - 1; i > 0; i--) {
+                j = (size_t)rand() % i;
+                tmp = order[i];
+                order[i] = order[j];
+                order[j] = tmp;
+            }
+            for (i = 0; i < COMPUTE_CHASE_LINES; i++)
+                bench_compute.chase[order[i] * stride] = order[(i + 1) % COMPUTE_CHASE_LINES] * stride;
+            free(order);
+        }
+        break;
+    default:
+        strcpy(bench_compute.name, "spin");
+        break;
+    }
+    compute_calibrate();
+    return 0;
+}
+
+static inline void compute_finalize(void)
+{
+    free(bench_compute.chase);
+    free(bench_compute.c);
+    free(bench_compute.b);
+    free(bench_compute.a);
+    memset(&bench_compute, 0, sizeof(bench_compute));
+}
+
+#endif /* OSHMEM_BENCH_COMPUTE_H */
@@ -0,0 +1,206 @@
+#ifndef OSHMEM_BENCH_DUMP_H
+#define OSHMEM_BENCH_DUMP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DUMP_MAGIC                      "OSHBDUMP"
+#define DUMP_VERSION                    (1)
+#define DUMP_PATH_MAX                   (256)
+
+// Raw per-iteration latencies of one PE: a dump_header_t, then header.samples int64_t latencies in ns in
+// iteration order, skip iterations left out. samples is less than iterations only if the buffer couldn't grow.
+// A dump file holds one such region per PE, either one file per PE (PREFIX.PE.bin) or all PEs in one shared
+// file (PREFIX.bin). In the shared file every region starts at a multiple of the largest page size of the PEs,
+// so that every PE can map and fill its own region; header.region_bytes leads to the next one. The analysis tool in tools/ reads both layouts. Define DUMP_FORMAT_ONLY to include only
+// the format, without the OpenSHMEM writer.
+typedef struct dump_header{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;      // samples start at this offset from the header
+    uint64_t region_bytes;      // header, samples and padding up to the next region
+    int32_t pe, num_pes;
+    int64_t iterations, skip, samples;
+    double ticks_per_usec;
+    char host[64];
+    char timer[32];
+    char func[32];
+}dump_header_t;
+
+static inline int dump_header_valid(const dump_header_t *header, uint64_t bytes_left)
+{
+    return bytes_left >= sizeof(dump_header_t) && memcmp(header->magic, DUMP_MAGIC, 8) == 0 &&
+           header->version == DUMP_VERSION && header->header_bytes >= sizeof(dump_header_t) &&
+           header->region_bytes >= header->header_bytes + header->samples * sizeof(int64_t) &&
+           header->region_bytes <= bytes_left;
+}
+
+#ifndef DUMP_FORMAT_ONLY
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <shmem.h>
+
+typedef struct dump{
+    char prefix[DUMP_PATH_MAX];
+    int shared;
+    int64_t *samples;
+    long count, capacity;
+    long dropped;               // samples that didn't fit
+}dump_t;
+
+// -D PREFIX[:shared]
+static inline int dump_parse(const char *str, dump_t *dump)
+{
+    const char *colon = strrchr(str, ':');
+    size_t length = strlen(str);
+    memset(dump, 0, sizeof(*dump));
+    if (colon && strcmp(colon, ":shared") == 0) {
+        dump->shared = 1;
+        length = colon - str;
+    }
+    if (length == 0 || length >= DUMP_PATH_MAX - 16)
+        return -1;
+    memcpy(dump->prefix, str, length);
+    dump->prefix[length] = '\0';
+    return 0;
+}
+
+// Returns -1 on allocation failure.
+static inline int dump_init(dump_t *dump, long capacity)
+{
+    dump->count = 0;
+    dump->dropped = 0;
+    dump->capacity = capacity;
+    dump->samples = (int64_t *)malloc(capacity * sizeof(int64_t));
+    return dump->samples ? 0 : -1;
+}
+
+static inline void dump_destroy(dump_t *dump)
+{
+    free(dump->samples);
+    dump->samples = NULL;
+}
+
+// Makes room for extra more samples, for runs whose length isn't known up front. Call it outside the timed
+// loop; returns -1 if the buffer can't grow, in which case the samples that don't fit are dropped.
+static inline int dump_reserve(dump_t *dump, long extra)
+{
+    int64_t *samples;
+    long capacity = dump->capacity;
+    if (dump->count + extra <= capacity)
+        return 0;
+    while (capacity < dump->count + extra)
+        capacity = capacity ? 2 * capacity : extra;
+    samples = (int64_t *)realloc(dump->samples, capacity * sizeof(int64_t));
+    if (!samples)
+        return -1;
+    dump->samples = samples;
+    dump->capacity = capacity;
+    return 0;
+}
+
+static inline void dump_record(dump_t *dump, int64_t latency_ns)
+{
+    if (dump->count < dump->capacity)
+        dump->samples[dump->count++] = latency_ns;
+    else
+        dump->dropped++;
+}
+
+// Collective over all PEs: writes this PE's region into its own file or into the shared file.
+// Returns -1 if this PE couldn't write, and on every PE if the shared file's bookkeeping couldn't be allocated.
+static inline int dump_write(dump_t *dump, const dump_header_t *info)
+{
+    static long pSync[_SHMEM_COLLECT_SYNC_SIZE];
+    static long pSync_failed[_SHMEM_REDUCE_SYNC_SIZE];
+    static long pWrk_failed[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static long failed, any_failed;
+    static int64_t sizes[2];    // unpadded region bytes, page size
+    dump_header_t header = *info;
+    char path[DUMP_PATH_MAX + 32];
+    uint64_t offset = 0, total = 0, align = 0, data_bytes = dump->count * sizeof(int64_t);
+    int64_t *regions;
+    char *map;
+    int pe, fd, retval = 0, num_pes = shmem_n_pes(), my_pe = shmem_my_pe();
+    FILE *file;
+
+    memcpy(header.magic, DUMP_MAGIC, 8);
+    header.version = DUMP_VERSION;
+    header.header_bytes = sizeof(dump_header_t);
+    header.samples = dump->count;
+    header.region_bytes = sizeof(dump_header_t) + data_bytes;
+
+    if (!dump->shared)
+    {
+        snprintf(path, sizeof(path), "%s.%d.bin", dump->prefix, my_pe);
+        if ((file = fopen(path, "wb")) == NULL)
+            return -1;
+        if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+            (dump->count && fwrite(dump->samples, sizeof(int64_t), dump->count, file) != (size_t)dump->count))
+            retval = -1;
+        if (fclose(file) != 0)
+            retval = -1;
+        return retval;
+    }
+
+    // Shared file: every PE learns the sizes of all regions and the page sizes, every region is padded to the
+    // largest page size so that mmap() takes its offset on every PE, PE 0 sizes the file, then every PE maps its region
+    sizes[0] = (int64_t)header.region_bytes;
+    sizes[1] = (int64_t)sysconf(_SC_PAGESIZE);
+    regions = (int64_t *)shmem_malloc(2 * num_pes * sizeof(int64_t));
+    failed = (regions == NULL);
+    for (pe = 0; pe < _SHMEM_COLLECT_SYNC_SIZE; pe++)
+        pSync[pe] = _SHMEM_SYNC_VALUE;
+    for (pe = 0; pe < _SHMEM_REDUCE_SYNC_SIZE; pe++)
+        pSync_failed[pe] = _SHMEM_SYNC_VALUE;
+    shmem_barrier_all();
+    shmem_long_max_to_all(&any_failed, &failed, 1, 0, 0, num_pes, pWrk_failed, pSync_failed);
+    if (any_failed) {
+        shmem_barrier_all();
+        shmem_free(regions);
+        return -1;
+    }
+    shmem_fcollect64(regions, sizes, 2, 0, 0, num_pes, pSync);
+    for (pe = 0; pe < num_pes; pe++)
+        align = ((uint64_t)regions[2 * pe + 1] > align) ? (uint64_t)regions[2 * pe + 1] : align;
+    for (pe = 0; pe < num_pes; pe++) {
+        uint64_t padded = ((uint64_t)regions[2 * pe] + align - 1) / align * align;
+        offset += (pe < my_pe) ? padded : 0;
+        total += padded;
+    }
+    header.region_bytes = (header.region_bytes + align - 1) / align * align;
+    snprintf(path, sizeof(path), "%s.bin", dump->prefix);
+    if (my_pe == 0) {
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, (off_t)total) != 0)
+            retval = -1;
+        if (fd >= 0)
+            close(fd);
+    }
+    shmem_barrier_all();
+    if ((fd = open(path, O_RDWR)) < 0) {
+        retval = -1;
+    }
+    else {
+        map = (char *)mmap(NULL, header.region_bytes, PROT_WRITE, MAP_SHARED, fd, (off_t)offset);
+        if (map == MAP_FAILED)
+            retval = -1;
+        else {
+            memcpy(map, &header, sizeof(header));
+            memcpy(map + sizeof(header), dump->samples, data_bytes);
+            if (msync(map, header.region_bytes, MS_SYNC) != 0)
+                retval = -1;
+            munmap(map, header.region_bytes);
+        }
+        close(fd);
+    }
+    shmem_barrier_all();
+    shmem_free(regions);
+    return retval;
+}
+#endif /* DUMP_FORMAT_ONLY */
+
+#endif /* OSHMEM_BENCH_DUMP_H */
@@ -0,0 +1,123 @@
+#ifndef OSHMEM_BENCH_FWQ_H
+#define OSHMEM_BENCH_FWQ_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "oshmem_bench_timer.h"
+#include "oshmem_bench_compute.h"
+
+#define FWQ_DETOUR_THRESHOLD            (0.05)
+
+// Fixed-work-quantum OS noise profiler. The same calibrated amount of spin work is timed back to back;
+// on a quiet core every quantum takes the minimum time, so anything above it is a detour taken by the
+// OS (interrupts, daemons, scheduler ticks). A quantum counts as a detour once it runs
+// FWQ_DETOUR_THRESHOLD over the minimum. No communication happens while the quanta run.
+typedef enum fwq_signature_index{
+    FWQ_NOISE_PERCENT = 0,      // share of the elapsed time lost to detours
+    FWQ_DETOURS_PER_SEC,        // frequency of detours
+    FWQ_MEAN_DETOUR,            // usec
+    FWQ_MAX_DETOUR,             // usec
+    FWQ_PERIOD,                 // median time between the starts of successive detours, usec
+    FWQ_PERIOD_CV,              // coefficient of variation of that interval; near 0 for periodic noise
+    FWQ_SIGNATURE_SIZE
+}fwq_signature_index_t;
+
+static const char* fwq_signature_names[FWQ_SIGNATURE_SIZE] = {
+    "Noise-%", "Detours/s", "Mean-Detour", "Max-Detour", "Period", "Period-CV"
+};
+
+typedef struct fwq{
+    double quantum_usec;
+    long amount;
+    int quanta;
+    uint64_t *starts, *durations;   // ticks
+}fwq_t;
+
+// Calibrates the spin kernel; has to be called after timer_init().
+static inline int fwq_init(fwq_t *fwq, double quantum_usec, int quanta)
+{
+    memset(fwq, 0, sizeof(*fwq));
+    if (compute_init(COMPUTE_SPIN))
+        return -1;
+    fwq->quantum_usec = quantum_usec;
+    fwq->quanta = quanta;
+    fwq->amount = compute_amount_for_usec(quantum_usec);
+    fwq->starts = (uint64_t *)malloc(quanta * sizeof(uint64_t));
+    fwq->durations = (uint64_t *)malloc(quanta * sizeof(uint64_t));
+    return (fwq->starts && fwq->durations) ? 0 : -1;
+}
+
+static inline void fwq_destroy(fwq_t *fwq)
+{
+    free(fwq->durations);
+    free(fwq->starts);
+    compute_finalize();
+}
+
+static inline void fwq_run(fwq_t *fwq)
+{
+    uint64_t t_start, t_stop;
+    int i;
+    for (i = 0; i < fwq->quanta; i++)
+    {
+        t_start = timer_read();
+        compute_run(fwq->amount);
+        t_stop = timer_read();
+        fwq->starts[i] = t_start;
+        fwq->durations[i] = t_stop - t_start;
+    }
+}
+
+static inline int fwq_compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Reduces the quanta of this PE to its noise signature, indexed by fwq_signature_index_t.
+static inline void fwq_signature(const fwq_t *fwq, double *signature)
+{
+    uint64_t min_ticks = UINT64_MAX, total_ticks = 0, detour_ticks = 0, max_detour = 0, last_start = 0;
+    double *intervals, mean = 0, var = 0;
+    int i, detours = 0, n = 0;
+
+    memset(signature, 0, FWQ_SIGNATURE_SIZE * sizeof(double));
+    for (i = 0; i < fwq->quanta; i++)
+        min_ticks = (fwq->durations[i] < min_ticks) ? fwq->durations[i] : min_ticks;
+    intervals = (double *)malloc(fwq->quanta * sizeof(double));
+    for (i = 0; i < fwq->quanta; i++)
+    {
+        uint64_t detour = fwq->durations[i] - min_ticks;
+        total_ticks += fwq->durations[i];
+        if (detour <= FWQ_DETOUR_THRESHOLD * min_ticks)
+            continue;
+        detours++;
+        detour_ticks += detour;
+        max_detour = (detour > max_detour) ? detour : max_detour;
+        if (detours > 1 && intervals)
+            intervals[n++] = timer_ticks_to_usec(fwq->starts[i] - last_start);
+        last_start = fwq->starts[i];
+    }
+    if (total_ticks == 0)
+        return;
+    signature[FWQ_NOISE_PERCENT] = 100.0 * detour_ticks / total_ticks;
+    signature[FWQ_DETOURS_PER_SEC] = detours / (timer_ticks_to_usec(total_ticks) * 1e-6);
+    signature[FWQ_MEAN_DETOUR] = (detours) ? timer_ticks_to_usec(detour_ticks) / detours : 0;
+    signature[FWQ_MAX_DETOUR] = timer_ticks_to_usec(max_detour);
+    if (n > 0)
+    {
+        for (i = 0; i < n; i++)
+            mean += intervals[i];
+        mean /= n;
+        for (i = 0; i < n; i++)
+            var += (intervals[i] - mean) * (intervals[i] - mean);
+        qsort(intervals, n, sizeof(double), &fwq_compare_double);
+        signature[FWQ_PERIOD] = intervals[n / 2];
+        signature[FWQ_PERIOD_CV] = (mean > 0) ? sqrt(var / n) / mean : 0;
+    }
+    free(intervals);
+}
+
+#endif /* OSHMEM_BENCH_FWQ_H */
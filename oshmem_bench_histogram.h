@@ -0,0 +1,236 @@
+#ifndef OSHMEM_BENCH_HISTOGRAM_H
+#define OSHMEM_BENCH_HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <shmem.h>
+
+#define HISTOGRAM_DIGITS_DEFAULT        (3)
+#define HISTOGRAM_DIGITS_MAX            (5)
+#define HISTOGRAM_HIGHEST_NSEC          (3600LL * 1000 * 1000 * 1000)
+
+// Log-linear (HDR-style) latency histogram.
+// Values are nanoseconds. Every power-of-two range is split into sub_bucket_count linear bins,
+// so the relative error of any recorded value stays below 10^-significant_digits
+// while memory depends only on the precision and the trackable range, never on the sample count.
+// The bin layout is a pure function of (highest, significant_digits), so histograms
+// created with the same arguments on different PEs can be merged bin by bin.
+typedef struct histogram{
+    int64_t highest;
+    int significant_digits;
+    int sub_bucket_half_count_magnitude;
+    int64_t sub_bucket_count, sub_bucket_half_count, sub_bucket_mask;
+    int bucket_count, counts_len;
+    long *counts;
+    long total_count;
+    int64_t min, max;
+}histogram_t;
+
+static inline int histogram_init(histogram_t *h, int64_t highest, int significant_digits)
+{
+    int64_t largest_single_unit = 2, smallest_untrackable;
+    int sub_bucket_count_magnitude, i;
+
+    if (significant_digits < 1 || significant_digits > HISTOGRAM_DIGITS_MAX || highest < 2)
+        return -1;
+    memset(h, 0, sizeof(*h));
+    h->highest = highest;
+    h->significant_digits = significant_digits;
+
+    for (i = 0; i < significant_digits; i++)
+        largest_single_unit *= 10;
+    for (sub_bucket_count_magnitude = 0; ((int64_t)1 << sub_bucket_count_magnitude) < largest_single_unit; )
+        sub_bucket_count_magnitude++;
+    h->sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+    h->sub_bucket_count = (int64_t)1 << sub_bucket_count_magnitude;
+    h->sub_bucket_half_count = h->sub_bucket_count / 2;
+    h->sub_bucket_mask = h->sub_bucket_count - 1;
+
+    smallest_untrackable = h->sub_bucket_count;
+    h->bucket_count = 1;
+    while (smallest_untrackable <= highest) {
+        smallest_untrackable <<= 1;
+        h->bucket_count++;
+    }
+    h->counts_len = (h->bucket_count + 1) * (int)h->sub_bucket_half_count;
+    h->counts = (long *)calloc(h->counts_len, sizeof(long));
+    if (!h->counts)
+        return -1;
+    h->min = INT64_MAX;
+    return 0;
+}
+
+static inline void histogram_destroy(histogram_t *h)
+{
+    free(h->counts);
+    h->counts = NULL;
+}
+
+static inline void histogram_reset(histogram_t *h)
+{
+    memset(h->counts, 0, h->counts_len * sizeof(long));
+    h->total_count = 0;
+    h->min = INT64_MAX;
+    h->max = 0;
+}
+
+static inline int histogram_counts_index(const histogram_t *h, int64_t value)
+{
+    int pow2ceiling = 64 - __builtin_clzll((uint64_t)(value | h->sub_bucket_mask));
+    int bucket_index = pow2ceiling - (h->sub_bucket_half_count_magnitude + 1);
+    int64_t sub_bucket_index = value >> bucket_index;
+    return ((bucket_index + 1) << h->sub_bucket_half_count_magnitude) + (int)(sub_bucket_index - h->sub_bucket_half_count);
+}
+
+static inline int64_t histogram_lowest_value_at(const histogram_t *h, int index)
+{
+    int bucket_index = (index >> h->sub_bucket_half_count_magnitude) - 1;
+    int64_t sub_bucket_index = (index & (h->sub_bucket_half_count - 1)) + h->sub_bucket_half_count;
+    if (bucket_index < 0) {
+        sub_bucket_index -= h->sub_bucket_half_count;
+        bucket_index = 0;
+    }
+    return sub_bucket_index << bucket_index;
+}
+
+static inline int64_t histogram_highest_value_at(const histogram_t *h, int index)
+{
+    if (index + 1 >= h->counts_len)
+        return h->highest;
+    return histogram_lowest_value_at(h, index + 1) - 1;
+}
+
+// O(1): a couple of shifts and one increment, cheap enough for the timing loop.
+static inline void histogram_record(histogram_t *h, int64_t value)
+{
+    if (value < 0)
+        value = 0;
+    if (value > h->highest)
+        value = h->highest;
+    h->counts[histogram_counts_index(h, value)]++;
+    h->total_count++;
+    if (value < h->min)
+        h->min = value;
+    if (value > h->max)
+        h->max = value;
+}
+
+// The rank-th smallest value (1-based), reported as the upper edge of its bin.
+static inline int64_t histogram_value_at_rank(const histogram_t *h, long rank)
+{
+    long cumulative = 0;
+    int i;
+
+    if (h->total_count == 0)
+        return 0;
+    if (rank > h->total_count)
+        rank = h->total_count;
+    for (i = 0; i < h->counts_len; i++) {
+        cumulative += h->counts[i];
+        if (cumulative >= rank) {
+            int64_t value = histogram_highest_value_at(h, i);
+            return (value > h->max) ? h->max : value;
+        }
+    }
+    return h->max;
+}
+
+// Nearest-rank percentile (percentage in [0,1]), reported as the upper edge of the matching bin.
+static inline int64_t histogram_value_at_percentile(const histogram_t *h, double percentage)
+{
+    return histogram_value_at_rank(h, (long)((double)h->total_count * percentage) + 1);
+}
+
+// Distribution-free confidence interval of a percentile from order statistics: the true percentile lies
+// between the values at ranks n*p -/+ z*sqrt(n*p*(1-p)) (z = 1.96 for 95%). Returns the width of that
+// interval relative to the estimate, or HUGE_VAL while those ranks still fall outside the sample.
+static inline double histogram_percentile_ci(const histogram_t *h, double percentage, double z, int64_t *lower, int64_t *upper)
+{
+    double n = (double)h->total_count, center = n * percentage, spread = z * sqrt(n * percentage * (1 - percentage));
+    long rank_lower = (long)floor(center - spread), rank_upper = (long)ceil(center + spread) + 1;
+    int64_t estimate;
+
+    *lower = *upper = 0;
+    if (rank_lower < 1 || rank_upper > h->total_count)
+        return HUGE_VAL;
+    *lower = histogram_value_at_rank(h, rank_lower);
+    *upper = histogram_value_at_rank(h, rank_upper);
+    estimate = histogram_value_at_percentile(h, percentage);
+    return (estimate > 0) ? (double)(*upper - *lower) / estimate : 0;
+}
+
+static inline void histogram_print(FILE *stream, const histogram_t *h, const char *prefix)
+{
+    int i;
+    for (i = 0; i < h->counts_len; i++)
+        if (h->counts[i])
+            fprintf(stream, "%s[%12lld-%12lld] ns: %ld\n", prefix, (long long)histogram_lowest_value_at(h, i),
+                    (long long)histogram_highest_value_at(h, i), h->counts[i]);
+}
+
+// Merges the local histograms of the active set into one job-wide histogram in dst.
+// dst must have been created with the same highest/significant_digits as src on every PE,
+// so the bins line up and a plain element-wise sum is the exact merged distribution.
+// Collective over all PEs (symmetric buffers are allocated here); only the active set is reduced.
+// Returns -1 on every PE if the allocation failed on any of them.
+static inline int histogram_reduce_all(histogram_t *dst, const histogram_t *src, int PE_start, int logPE_stride, int PE_size)
+{
+    static long failed, any_failed;
+    static long pWrk_failed[SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static long pSync_failed[SHMEM_REDUCE_SYNC_SIZE];
+    int nreduce = src->counts_len + 2, i;
+    size_t wrk_size = nreduce / 2 + 1;
+    long *src_buff, *dst_buff, *pWrk, *pSync1, *pSync2;
+    int retval = 0;
+
+    if (wrk_size < SHMEM_REDUCE_MIN_WRKDATA_SIZE)
+        wrk_size = SHMEM_REDUCE_MIN_WRKDATA_SIZE;
+    src_buff = (long *)shmem_malloc(nreduce * sizeof(long));
+    dst_buff = (long *)shmem_malloc(nreduce * sizeof(long));
+    pWrk = (long *)shmem_malloc(wrk_size * sizeof(long));
+    pSync1 = (long *)shmem_malloc(SHMEM_REDUCE_SYNC_SIZE * sizeof(long));
+    pSync2 = (long *)shmem_malloc(SHMEM_REDUCE_SYNC_SIZE * sizeof(long));
+    // A PE that couldn't allocate must not leave the others waiting in the reductions
+    failed = (!src_buff || !dst_buff || !pWrk || !pSync1 || !pSync2);
+    for (i = 0; i < SHMEM_REDUCE_SYNC_SIZE; i++)
+        pSync_failed[i] = SHMEM_SYNC_VALUE;
+    shmem_barrier_all();
+    shmem_long_max_to_all(&any_failed, &failed, 1, 0, 0, shmem_n_pes(), pWrk_failed, pSync_failed);
+    if (any_failed) {
+        retval = -1;
+        goto out;
+    }
+    for (i = 0; i < SHMEM_REDUCE_SYNC_SIZE; i++) {
+        pSync1[i] = SHMEM_SYNC_VALUE;
+        pSync2[i] = SHMEM_SYNC_VALUE;
+    }
+    memcpy(src_buff, src->counts, src->counts_len * sizeof(long));
+    shmem_barrier_all();
+
+    shmem_long_sum_to_all(dst_buff, src_buff, src->counts_len, PE_start, logPE_stride, PE_size, pWrk, pSync1);
+    memcpy(dst->counts, dst_buff, src->counts_len * sizeof(long));
+    // min is reduced as -min so that a single max reduction covers both extremes
+    src_buff[0] = (long)src->max;
+    src_buff[1] = (src->total_count) ? -(long)src->min : LONG_MIN;
+    shmem_long_max_to_all(dst_buff, src_buff, 2, PE_start, logPE_stride, PE_size, pWrk, pSync2);
+    dst->max = dst_buff[0];
+    dst->min = (dst_buff[1] == LONG_MIN) ? INT64_MAX : -dst_buff[1];
+    dst->total_count = 0;
+    for (i = 0; i < dst->counts_len; i++)
+        dst->total_count += dst->counts[i];
+
+out:
+    shmem_barrier_all();
+    shmem_free(pSync2);
+    shmem_free(pSync1);
+    shmem_free(pWrk);
+    shmem_free(dst_buff);
+    shmem_free(src_buff);
+    return retval;
+}
+
+#endif /* OSHMEM_BENCH_HISTOGRAM_H */
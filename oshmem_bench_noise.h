@@ -0,0 +1,142 @@
+#ifndef OSHMEM_BENCH_NOISE_H
+#define OSHMEM_BENCH_NOISE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "oshmem_bench_timer.h"
+#include "oshmem_bench_histogram.h"
+
+// Synthetic noise injected on every PE right before the measured call, as a busy wait on the timer:
+//   fixed:USEC[:PROB]            : USEC with probability PROB (default 1) per iteration
+//   exp:MEAN[:PROB]              : exponentially distributed, mean MEAN usec, with probability PROB
+//   pareto:SCALE:ALPHA[:PROB]    : Pareto distributed (heavy tail), minimum SCALE usec, shape ALPHA
+//   periodic:PERIOD:DURATION     : a timer tick of DURATION usec every PERIOD usec of local time, random phase per PE
+//   straggler:USEC[:PE]          : only PE (default the last one) is delayed, by USEC every iteration
+// Every PE draws from its own random stream, so the delays are independent across PEs.
+typedef enum noise_kind{
+    NOISE_NONE = 0,
+    NOISE_FIXED,
+    NOISE_EXPONENTIAL,
+    NOISE_PARETO,
+    NOISE_PERIODIC,
+    NOISE_STRAGGLER
+}noise_kind_t;
+
+typedef struct noise{
+    noise_kind_t kind;
+    char name[60];
+    double usec, alpha, probability;
+    double period_usec;
+    int straggler_pe;
+    uint64_t rng;
+    uint64_t period_ticks, next_tick;
+    histogram_t injected;       // injected delay per iteration in ns, zeros included
+    double injected_usec;       // sum of the recorded delays
+}noise_t;
+
+static inline int noise_parse(const char *str, noise_t *noise)
+{
+    int n;
+    memset(noise, 0, sizeof(*noise));
+    noise->probability = 1;
+    noise->straggler_pe = -1;
+    if ((n = sscanf(str, "fixed:%lf:%lf", &noise->usec, &noise->probability)) >= 1)
+        noise->kind = NOISE_FIXED;
+    else if ((n = sscanf(str, "exp:%lf:%lf", &noise->usec, &noise->probability)) >= 1)
+        noise->kind = NOISE_EXPONENTIAL;
+    else if ((n = sscanf(str, "pareto:%lf:%lf:%lf", &noise->usec, &noise->alpha, &noise->probability)) >= 2)
+        noise->kind = NOISE_PARETO;
+    else if ((n = sscanf(str, "periodic:%lf:%lf", &noise->period_usec, &noise->usec)) == 2)
+        noise->kind = NOISE_PERIODIC;
+    else if ((n = sscanf(str, "straggler:%lf:%d", &noise->usec, &noise->straggler_pe)) >= 1)
+        noise->kind = NOISE_STRAGGLER;
+    else
+        return -1;
+    if (noise->usec < 0 || noise->probability < 0 || noise->probability > 1 ||
+        (noise->kind == NOISE_PARETO && noise->alpha <= 0) ||
+        (noise->kind == NOISE_PERIODIC && noise->period_usec <= 0))
+        return -1;
+    strncpy(noise->name, str, sizeof(noise->name) - 1);
+    return 0;
+}
+
+// Uniform in (0, 1], xorshift64*
+static inline double noise_uniform(noise_t *noise)
+{
+    noise->rng ^= noise->rng >> 12;
+    noise->rng ^= noise->rng << 25;
+    noise->rng ^= noise->rng >> 27;
+    return ((noise->rng * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0) + (1.0 / 9007199254740992.0);
+}
+
+// Has to be called after timer_init(). Returns -1 on a bad straggler PE or allocation failure.
+static inline int noise_init(noise_t *noise, int my_pe, int num_pes, int significant_digits)
+{
+    if (noise->kind == NOISE_STRAGGLER) {
+        if (noise->straggler_pe < 0)
+            noise->straggler_pe = num_pes - 1;
+        if (noise->straggler_pe >= num_pes)
+            return -1;
+    }
+    noise->rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(my_pe + 1);
+    if (noise->kind == NOISE_PERIODIC) {
+        noise->period_ticks = (uint64_t)(noise->period_usec * bench_timer.ticks_per_usec);
+        noise->next_tick = timer_read() + (uint64_t)(noise_uniform(noise) * noise->period_ticks);
+    }
+    return histogram_init(&noise->injected, HISTOGRAM_HIGHEST_NSEC, significant_digits);
+}
+
+static inline void noise_destroy(noise_t *noise)
+{
+    histogram_destroy(&noise->injected);
+}
+
+static inline double noise_draw_usec(noise_t *noise, int my_pe)
+{
+    uint64_t now;
+    switch (noise->kind)
+    {
+    case NOISE_FIXED:
+        return (noise_uniform(noise) <= noise->probability) ? noise->usec : 0;
+    case NOISE_EXPONENTIAL:
+        return (noise_uniform(noise) <= noise->probability) ? -noise->usec * log(noise_uniform(noise)) : 0;
+    case NOISE_PARETO:
+        return (noise_uniform(noise) <= noise->probability) ? noise->usec / pow(noise_uniform(noise), 1.0 / noise->alpha) : 0;
+    case NOISE_PERIODIC:
+        // A tick that fell due since the last iteration is delivered now, once; missed ticks are skipped
+        now = timer_read();
+        if (now < noise->next_tick)
+            return 0;
+        while (noise->next_tick <= now)
+            noise->next_tick += noise->period_ticks;
+        return noise->usec;
+    case NOISE_STRAGGLER:
+        return (my_pe == noise->straggler_pe) ? noise->usec : 0;
+    default:
+        return 0;
+    }
+}
+
+// Busy-waits for the drawn delay and returns it in ns.
+static inline int64_t noise_inject(noise_t *noise, int my_pe)
+{
+    double usec = noise_draw_usec(noise, my_pe);
+    uint64_t t_start, ticks;
+    if (usec <= 0)
+        return 0;
+    ticks = (uint64_t)(usec * bench_timer.ticks_per_usec);
+    t_start = timer_read();
+    while (timer_read() - t_start < ticks)
+        ;
+    return (int64_t)(usec * 1000.0);
+}
+
+static inline void noise_record(noise_t *noise, int64_t injected_ns)
+{
+    histogram_record(&noise->injected, injected_ns);
+    noise->injected_usec += injected_ns / 1000.0;
+}
+
+#endif /* OSHMEM_BENCH_NOISE_H */
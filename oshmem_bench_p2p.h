@@ -0,0 +1,147 @@
+#ifndef OSHMEM_BENCH_P2P_H
+#define OSHMEM_BENCH_P2P_H
+
+#include <stdint.h>
+#include <string.h>
+#include <shmem.h>
+
+// shmem_put_signal and shmem_signal_wait_until are OpenSHMEM 1.5 API.
+#if SHMEM_MAJOR_VERSION > 1 || (SHMEM_MAJOR_VERSION == 1 && SHMEM_MINOR_VERSION >= 5)
+#define HAVE_SHMEM_SIGNAL               (1)
+#else
+#define HAVE_SHMEM_SIGNAL               (0)
+#endif
+
+#define P2P_OUTSTANDING_MAX             (64)
+#define P2P_ROOT                        (0)
+
+// Flag-based point-to-point signaling between PE 0 and a partner, or from PE 0 to every other PE:
+//   ping-pong  : PE 0 signals the partner and waits for the partner's signal back (one round trip)
+//   notify-all : PE 0 signals every other PE, each of them acknowledges with an atomic add on a
+//                counter of PE 0, and PE 0 waits until all acknowledgements are in
+// Flags only ever grow (the caller's epoch, compared with SHMEM_CMP_GE), so they are never reset
+// between calls; p2p_reset() restarts the epochs between two kinds of measurement.
+typedef struct p2p_state{
+    long *flag;             // symmetric
+    long *ack;              // symmetric, only used on PE 0
+    uint64_t *signal;       // symmetric, put_signal flag
+    uint64_t *ack_signal;   // symmetric, put_signal acknowledgements, only used on PE 0
+    long *payload;          // symmetric [P2P_OUTSTANDING_MAX]
+    int my_pe, num_pes, partner;
+    long epoch;
+}p2p_state_t;
+
+static p2p_state_t bench_p2p;
+
+// Collective over all PEs. Returns -1 on allocation failure.
+static inline int p2p_init(int partner)
+{
+    memset(&bench_p2p, 0, sizeof(bench_p2p));
+    bench_p2p.my_pe = shmem_my_pe();
+    bench_p2p.num_pes = shmem_n_pes();
+    bench_p2p.partner = partner;
+    bench_p2p.flag = (long *)shmem_malloc(sizeof(long));
+    bench_p2p.ack = (long *)shmem_malloc(sizeof(long));
+    bench_p2p.signal = (uint64_t *)shmem_malloc(sizeof(uint64_t));
+    bench_p2p.ack_signal = (uint64_t *)shmem_malloc(sizeof(uint64_t));
+    bench_p2p.payload = (long *)shmem_malloc(P2P_OUTSTANDING_MAX * sizeof(long));
+    if (!bench_p2p.flag || !bench_p2p.ack || !bench_p2p.signal || !bench_p2p.ack_signal || !bench_p2p.payload)
+        return -1;
+    memset(bench_p2p.payload, 0, P2P_OUTSTANDING_MAX * sizeof(long));
+    *bench_p2p.flag = *bench_p2p.ack = 0;
+    *bench_p2p.signal = *bench_p2p.ack_signal = 0;
+    shmem_barrier_all();
+    return 0;
+}
+
+static inline void p2p_finalize(void)
+{
+    shmem_barrier_all();
+    shmem_free(bench_p2p.payload);
+    shmem_free(bench_p2p.ack_signal);
+    shmem_free(bench_p2p.signal);
+    shmem_free(bench_p2p.ack);
+    shmem_free(bench_p2p.flag);
+}
+
+// Collective over all PEs: completes everything in flight and restarts the epochs.
+static inline void p2p_reset(void)
+{
+    shmem_quiet();
+    shmem_barrier_all();
+    *bench_p2p.flag = *bench_p2p.ack = 0;
+    *bench_p2p.signal = *bench_p2p.ack_signal = 0;
+    bench_p2p.epoch = 0;
+    shmem_barrier_all();
+}
+
+static inline void p2p_pingpong_p(void)
+{
+    long epoch = ++bench_p2p.epoch;
+    if (bench_p2p.my_pe == P2P_ROOT) {
+        shmem_long_p(bench_p2p.flag, epoch, bench_p2p.partner);
+        shmem_long_wait_until(bench_p2p.flag, SHMEM_CMP_GE, epoch);
+    }
+    else if (bench_p2p.my_pe == bench_p2p.partner) {
+        shmem_long_wait_until(bench_p2p.flag, SHMEM_CMP_GE, epoch);
+        shmem_long_p(bench_p2p.flag, epoch, P2P_ROOT);
+    }
+}
+
+static inline void p2p_notify_p(void)
+{
+    long epoch = ++bench_p2p.epoch;
+    int pe;
+    if (bench_p2p.my_pe == P2P_ROOT) {
+        for (pe = 0; pe < bench_p2p.num_pes; pe++)
+            if (pe != P2P_ROOT)
+                shmem_long_p(bench_p2p.flag, epoch, pe);
+        shmem_long_wait_until(bench_p2p.ack, SHMEM_CMP_GE, epoch * (bench_p2p.num_pes - 1));
+    }
+    else {
+        shmem_long_wait_until(bench_p2p.flag, SHMEM_CMP_GE, epoch);
+        shmem_long_atomic_add(bench_p2p.ack, 1, P2P_ROOT);
+    }
+}
+
+#if HAVE_SHMEM_SIGNAL
+// The same exchanges with a one-element payload delivered together with the flag
+static inline void p2p_pingpong_signal(void)
+{
+    uint64_t epoch = (uint64_t)++bench_p2p.epoch;
+    if (bench_p2p.my_pe == P2P_ROOT) {
+        shmem_long_put_signal(bench_p2p.payload, bench_p2p.payload, 1, bench_p2p.signal, epoch, SHMEM_SIGNAL_SET, bench_p2p.partner);
+        shmem_signal_wait_until(bench_p2p.signal, SHMEM_CMP_GE, epoch);
+    }
+    else if (bench_p2p.my_pe == bench_p2p.partner) {
+        shmem_signal_wait_until(bench_p2p.signal, SHMEM_CMP_GE, epoch);
+        shmem_long_put_signal(bench_p2p.payload, bench_p2p.payload, 1, bench_p2p.signal, epoch, SHMEM_SIGNAL_SET, P2P_ROOT);
+    }
+}
+
+static inline void p2p_notify_signal(void)
+{
+    uint64_t epoch = (uint64_t)++bench_p2p.epoch;
+    int pe;
+    if (bench_p2p.my_pe == P2P_ROOT) {
+        for (pe = 0; pe < bench_p2p.num_pes; pe++)
+            if (pe != P2P_ROOT)
+                shmem_long_put_signal(bench_p2p.payload, bench_p2p.payload, 1, bench_p2p.signal, epoch, SHMEM_SIGNAL_SET, pe);
+        shmem_signal_wait_until(bench_p2p.ack_signal, SHMEM_CMP_GE, epoch * (bench_p2p.num_pes - 1));
+    }
+    else {
+        shmem_signal_wait_until(bench_p2p.signal, SHMEM_CMP_GE, epoch);
+        shmem_long_put_signal(bench_p2p.payload, bench_p2p.payload, 1, bench_p2p.ack_signal, 1, SHMEM_SIGNAL_ADD, P2P_ROOT);
+    }
+}
+#endif
+
+// Leaves outstanding one-element non-blocking puts to the partner, for timing a following fence or quiet.
+static inline void p2p_issue_puts(int outstanding)
+{
+    int k;
+    for (k = 0; k < outstanding; k++)
+        shmem_long_put_nbi(bench_p2p.payload + k, bench_p2p.payload + k, 1, bench_p2p.partner);
+}
+
+#endif /* OSHMEM_BENCH_P2P_H */
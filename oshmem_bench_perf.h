@@ -0,0 +1,200 @@
+#ifndef OSHMEM_BENCH_PERF_H
+#define OSHMEM_BENCH_PERF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <linux/perf_event.h>
+#include "oshmem_bench_timer.h"
+
+#define PERF_EVENTS_MAX                 (5)
+#define PERF_CONTEXT_SWITCHES           (4)
+#define PERF_CALIBRATION_READS          (1000)
+
+typedef struct perf_event_desc{
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+}perf_event_desc_t;
+
+static const perf_event_desc_t perf_events[PERF_EVENTS_MAX] = {
+    { "cycles"          , PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions"    , PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "llc-misses"      , PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch-misses"   , PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES }
+};
+
+// Hardware counters of this PE around the timed call, from perf_event_open. All events are one group, so a
+// single read() returns them together; it happens outside the timed region, and the counts of an empty
+// pair of reads (minimum over PERF_CALIBRATION_READS) are subtracted from every delta. Events are counted
+// in user and kernel mode where perf_event_paranoid allows it and in user mode only otherwise; an event the
+// PMU doesn't offer (e.g. in a VM) is left out. Without the software event, context switches come from
+// getrusage(RUSAGE_THREAD) instead.
+// The deltas and the latency of up to capacity iterations are kept to relate the counters to the slow tail.
+typedef struct perf{
+    int leader;                     // group leader fd, -1 if no event could be opened
+    int fd[PERF_EVENTS_MAX];
+    int slot[PERF_EVENTS_MAX];      // position in a group read, -1 if not available
+    int user_only[PERF_EVENTS_MAX];
+    int rusage_switches;            // context switches from getrusage
+    int nslots;
+    uint64_t buffer[1 + PERF_EVENTS_MAX];
+    double before[PERF_EVENTS_MAX], after[PERF_EVENTS_MAX];
+    double overhead[PERF_EVENTS_MAX];
+    double *samples;                // [capacity][PERF_EVENTS_MAX]
+    double *latencies;              // [capacity], ns
+    long count, capacity;
+}perf_t;
+
+static inline int perf_open_event(perf_t *perf, int e, int exclude_kernel)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_events[e].type;
+    attr.config = perf_events[e].config;
+    attr.disabled = (perf->leader < 0);
+    attr.exclude_kernel = exclude_kernel;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, perf->leader, 0);
+}
+
+static inline int perf_available(const perf_t *perf, int e)
+{
+    return perf->slot[e] >= 0 || (e == PERF_CONTEXT_SWITCHES && perf->rusage_switches);
+}
+
+static inline void perf_read(perf_t *perf, double *values)
+{
+    struct rusage usage;
+    int e;
+    if (perf->leader >= 0 && read(perf->leader, perf->buffer, (1 + perf->nslots) * sizeof(uint64_t)) < 0)
+        memset(perf->buffer, 0, sizeof(perf->buffer));
+    for (e = 0; e < PERF_EVENTS_MAX; e++)
+        values[e] = (perf->slot[e] >= 0) ? (double)perf->buffer[1 + perf->slot[e]] : 0;
+    if (perf->rusage_switches && getrusage(RUSAGE_THREAD, &usage) == 0)
+        values[PERF_CONTEXT_SWITCHES] = (double)(usage.ru_nvcsw + usage.ru_nivcsw);
+}
+
+// Counts of event e between the last two reads into before and after.
+static inline double perf_delta(const perf_t *perf, int e)
+{
+    double delta = perf->after[e] - perf->before[e] - perf->overhead[e];
+    return (delta > 0) ? delta : 0;
+}
+
+// capacity is the number of iterations perf_record() keeps, 0 if only perf_delta() is used.
+// Returns -1 on allocation failure; events that can't be opened are not an error.
+static inline int perf_init(perf_t *perf, long capacity)
+{
+    int e, i;
+    memset(perf, 0, sizeof(*perf));
+    perf->leader = -1;
+    for (e = 0; e < PERF_EVENTS_MAX; e++)
+    {
+        perf->slot[e] = -1;
+        if ((perf->fd[e] = perf_open_event(perf, e, 0)) < 0) {
+            perf->user_only[e] = 1;
+            perf->fd[e] = perf_open_event(perf, e, 1);
+        }
+        // Context switches happen in the kernel, a user-only count of them is always zero
+        if (perf->fd[e] >= 0 && e == PERF_CONTEXT_SWITCHES && perf->user_only[e]) {
+            close(perf->fd[e]);
+            perf->fd[e] = -1;
+        }
+        if (perf->fd[e] < 0)
+            continue;
+        if (perf->leader < 0)
+            perf->leader = perf->fd[e];
+        perf->slot[e] = perf->nslots++;
+    }
+    perf->rusage_switches = (perf->slot[PERF_CONTEXT_SWITCHES] < 0);
+    if (perf->leader >= 0) {
+        ioctl(perf->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(perf->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    for (e = 0; e < PERF_EVENTS_MAX; e++)
+        perf->overhead[e] = __DBL_MAX__;
+    for (i = 0; i < PERF_CALIBRATION_READS; i++)
+    {
+        perf_read(perf, perf->before);
+        (void)timer_read();
+        (void)timer_read();
+        perf_read(perf, perf->after);
+        for (e = 0; e < PERF_EVENTS_MAX; e++)
+            perf->overhead[e] = (perf->after[e] - perf->before[e] < perf->overhead[e]) ? perf->after[e] - perf->before[e] : perf->overhead[e];
+    }
+
+    perf->capacity = capacity;
+    if (capacity == 0)
+        return 0;
+    perf->samples = (double *)malloc(capacity * PERF_EVENTS_MAX * sizeof(double));
+    perf->latencies = (double *)malloc(capacity * sizeof(double));
+    return (perf->samples && perf->latencies) ? 0 : -1;
+}
+
+static inline void perf_destroy(perf_t *perf)
+{
+    int e;
+    for (e = PERF_EVENTS_MAX - 1; e >= 0; e--)
+        if (perf->fd[e] >= 0)
+            close(perf->fd[e]);
+    free(perf->latencies);
+    free(perf->samples);
+}
+
+// Keeps the deltas of the last pair of reads with the latency of the call between them.
+static inline void perf_record(perf_t *perf, int64_t latency_ns)
+{
+    int e;
+    if (perf->count >= perf->capacity)
+        return;
+    for (e = 0; e < PERF_EVENTS_MAX; e++)
+        perf->samples[perf->count * PERF_EVENTS_MAX + e] = perf_delta(perf, e);
+    perf->latencies[perf->count++] = (double)latency_ns;
+}
+
+// Per event e over the recorded iterations: mean count, mean count of the iterations at or above tail_ns
+// and Pearson's correlation of count and latency (0 if either is constant).
+static inline void perf_summarize(const perf_t *perf, double tail_ns, double *all, double *tail, double *r)
+{
+    double sx, sy, sxx, syy, sxy, x, y, cov, var_x, var_y;
+    long i, ntail;
+    int e;
+    for (e = 0; e < PERF_EVENTS_MAX; e++)
+    {
+        sx = sy = sxx = syy = sxy = tail[e] = 0;
+        ntail = 0;
+        for (i = 0; i < perf->count; i++)
+        {
+            x = perf->samples[i * PERF_EVENTS_MAX + e];
+            y = perf->latencies[i];
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            syy += y * y;
+            sxy += x * y;
+            if (y >= tail_ns) {
+                tail[e] += x;
+                ntail++;
+            }
+        }
+        all[e] = perf->count ? sx / perf->count : 0;
+        tail[e] = ntail ? tail[e] / ntail : 0;
+        cov = perf->count * sxy - sx * sy;
+        var_x = perf->count * sxx - sx * sx;
+        var_y = perf->count * syy - sy * sy;
+        r[e] = (var_x > 0 && var_y > 0) ? cov / sqrt(var_x * var_y) : 0;
+    }
+}
+
+#endif /* OSHMEM_BENCH_PERF_H */
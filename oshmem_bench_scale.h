@@ -0,0 +1,94 @@
+#ifndef OSHMEM_BENCH_SCALE_H
+#define OSHMEM_BENCH_SCALE_H
+
+#include <stdio.h>
+#include <math.h>
+#include <shmem.h>
+#include "oshmem_bench_sync_algorithms.h"
+
+#define SCALE_SIZES_MAX                 (64)
+
+// PE-count scaling sweep inside one launch. Step s runs on the nested subset of PEs 0..P-1 for
+// P = 2, 4, 8, ... and finally the whole job, so a latency-versus-P curve costs a single shmem_init.
+// PEs outside the subset skip the step and wait in the caller's shmem_barrier_all() until it is done.
+// Library syncs are swapped for their active-set versions; the user-level algorithms follow the
+// group set in sync_algorithms_set_group().
+static int scale_group_size;
+static long scale_pSync1[_SHMEM_BARRIER_SYNC_SIZE];
+static long scale_pSync2[_SHMEM_BARRIER_SYNC_SIZE];
+static long scale_pSync3[_SHMEM_BARRIER_SYNC_SIZE];
+
+static inline void scale_sync_all(void)
+{
+    shmem_sync(0, 0, scale_group_size, scale_pSync1);
+}
+
+static inline void scale_barrier_all(void)
+{
+    shmem_barrier(0, 0, scale_group_size, scale_pSync2);
+}
+
+// Lines the subset up between timed calls, on a pSync of its own so it never collides with the measured call.
+static inline void scale_align(void)
+{
+    shmem_barrier(0, 0, scale_group_size, scale_pSync3);
+}
+
+// Returns the subset version of func: the library syncs are remapped, everything else already follows the group.
+static inline void (*scale_func(void (*func)(void)))(void)
+{
+    if (func == &shmem_sync_all)
+        return &scale_sync_all;
+    if (func == &shmem_barrier_all)
+        return &scale_barrier_all;
+    return func;
+}
+
+// Fills sizes with 2, 4, 8, ... below num_pes followed by num_pes itself; returns how many there are.
+static inline int scale_sizes(int num_pes, int *sizes)
+{
+    int n = 0, p;
+    for (p = 2; p < num_pes && n < SCALE_SIZES_MAX - 1; p *= 2)
+        sizes[n++] = p;
+    sizes[n++] = num_pes;
+    return n;
+}
+
+// Collective over all PEs.
+static inline void scale_set_group(int group_size)
+{
+    int i;
+    for (i = 0; i < _SHMEM_BARRIER_SYNC_SIZE; i++) {
+        scale_pSync1[i] = _SHMEM_SYNC_VALUE;
+        scale_pSync2[i] = _SHMEM_SYNC_VALUE;
+        scale_pSync3[i] = _SHMEM_SYNC_VALUE;
+    }
+    scale_group_size = group_size;
+    sync_algorithms_set_group(group_size);
+}
+
+// Least-squares fit of value = intercept + slope * log2(P). The slope is the cost of one doubling.
+static inline void scale_fit_log2(int n, const int *sizes, const double *values, double *slope, double *intercept)
+{
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, x, d;
+    int i;
+    for (i = 0; i < n; i++) {
+        x = log2((double)sizes[i]);
+        sx += x;
+        sy += values[i];
+        sxx += x * x;
+        sxy += x * values[i];
+    }
+    d = n * sxx - sx * sx;
+    *slope = (d != 0) ? (n * sxy - sx * sy) / d : 0;
+    *intercept = (n > 0) ? (sy - *slope * sx) / n : 0;
+}
+
+static inline void scale_print_fit(FILE *stream, const char *label, int n, const int *sizes, const double *values)
+{
+    double slope, intercept;
+    scale_fit_log2(n, sizes, values, &slope, &intercept);
+    fprintf(stream, "# log2(P) fit of %s: %.3f + %.3f * log2(P) us\n", label, intercept, slope);
+}
+
+#endif /* OSHMEM_BENCH_SCALE_H */
@@ -0,0 +1,379 @@
+#ifndef OSHMEM_BENCH_SERIES_H
+#define OSHMEM_BENCH_SERIES_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <shmem.h>
+#include "oshmem_bench_timer.h"
+#include "oshmem_bench_affinity.h"
+#include "oshmem_bench_stats.h"
+
+#define SERIES_WINDOWS_MAX              (1 << 20)
+#define SERIES_LAG_BINS                 (1024)
+#define SERIES_SPIKES_MAX               (1 << 16)
+#define SERIES_PERIODS                  (3)
+#define SERIES_PEAK_PAIRS               (5)
+#define SERIES_PEAK_RATIO               (2.0)
+#define SERIES_CORRELATION_PES          (256)
+#define SERIES_CORRELATION_WINDOWS      (4096)
+
+// Latency over the course of the run, to see when the tail happens:
+//   iter:N     : windows of N consecutive iterations
+//   time:USEC  : windows of USEC, counted from the first recorded iteration
+// Every PE keeps the start time and the latency of its iterations and reduces every window to its p50, p99
+// and maximum. Iterations at or above the PE's tail percentile are spikes; spikes less than two lag bins after
+// the previous one belong to its burst and don't count. The pairwise time differences of the spikes, summed
+// over all PEs, make an autocorrelogram of the spike train. It is set against the pairs that as many random
+// spikes would give, so a lag where spikes recur more often than by chance (x-Random >= 2) is a spike period.
+// Lags go up to a quarter of the shortest run of any PE.
+// The window maxima of every pair of PEs are correlated as well, same-host and cross-host pairs apart. A source
+// that runs on each node separately correlates within a host but not across hosts, a system-wide one across
+// all of them. In a sync every PE waits for the slowest, though, so this only separates the two for calls that
+// don't couple all PEs; the x-Random of a period and the PEs that see it on their own hold either way.
+typedef enum series_kind{
+    SERIES_ITERATIONS = 0,
+    SERIES_TIME
+}series_kind_t;
+
+typedef struct series_window{
+    double start_usec;
+    long count;
+    double p50, p99, max;               // usec, 0 for an empty time window
+}series_window_t;
+
+typedef struct series_period{
+    double usec, ratio, pairs;
+    int pes;                            // PEs whose own spike train shows the period
+}series_period_t;
+
+typedef struct series{
+    series_kind_t kind;
+    char name[60];
+    long window_iterations;
+    double window_usec;
+    double *t_usec, *latency_usec;      // [capacity]
+    long count, capacity;
+    uint64_t t_begin;
+    series_window_t *windows;
+    long nwindows, job_windows;         // this PE's and the fewest of any PE
+    double *lags, *job_lags;            // symmetric [2 * SERIES_LAG_BINS]: spike pairs, then pairs of random spikes
+    double *pWrk;
+    long *pSync;
+    double lag_bin_usec, span_usec;
+    double spikes, job_spikes;
+    series_period_t periods[SERIES_PERIODS];
+    int nperiods;
+    double r_same[3], r_cross[3];       // mean, min and max over the pairs
+    long pairs_same, pairs_cross;
+}series_t;
+
+static inline int series_parse(const char *str, series_t *series)
+{
+    memset(series, 0, sizeof(*series));
+    if (sscanf(str, "iter:%ld", &series->window_iterations) == 1 && series->window_iterations > 0)
+        series->kind = SERIES_ITERATIONS;
+    else if (sscanf(str, "time:%lf", &series->window_usec) == 1 && series->window_usec > 0)
+        series->kind = SERIES_TIME;
+    else
+        return -1;
+    strncpy(series->name, str, sizeof(series->name) - 1);
+    return 0;
+}
+
+// Collective over all PEs. Returns -1 on every PE if the allocation failed on any of them.
+static inline int series_init(series_t *series, long capacity)
+{
+    static long failed, any_failed;
+    static long pWrk_failed[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static long pSync_failed[_SHMEM_REDUCE_SYNC_SIZE];
+    int i;
+    series->count = 0;
+    series->capacity = capacity;
+    series->t_usec = (double *)malloc(capacity * sizeof(double));
+    series->latency_usec = (double *)malloc(capacity * sizeof(double));
+    series->lags = (double *)shmem_malloc(2 * SERIES_LAG_BINS * sizeof(double));
+    series->job_lags = (double *)shmem_malloc(2 * SERIES_LAG_BINS * sizeof(double));
+    series->pWrk = (double *)shmem_malloc((SERIES_LAG_BINS + 1) * sizeof(double));
+    series->pSync = (long *)shmem_malloc(_SHMEM_REDUCE_SYNC_SIZE * sizeof(long));
+    // A PE that couldn't allocate must not leave the others waiting in the collectives of the run
+    failed = (!series->t_usec || !series->latency_usec || !series->lags || !series->job_lags || !series->pWrk || !series->pSync);
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i++) {
+        pSync_failed[i] = _SHMEM_SYNC_VALUE;
+        if (series->pSync)
+            series->pSync[i] = _SHMEM_SYNC_VALUE;
+    }
+    shmem_barrier_all();
+    shmem_long_max_to_all(&any_failed, &failed, 1, 0, 0, shmem_n_pes(), pWrk_failed, pSync_failed);
+    return any_failed ? -1 : 0;
+}
+
+static inline void series_destroy(series_t *series)
+{
+    free(series->windows);
+    free(series->latency_usec);
+    free(series->t_usec);
+    shmem_barrier_all();
+    shmem_free(series->pSync);
+    shmem_free(series->pWrk);
+    shmem_free(series->job_lags);
+    shmem_free(series->lags);
+}
+
+static inline void series_record(series_t *series, uint64_t t_start, int64_t latency_ns)
+{
+    if (series->count == 0)
+        series->t_begin = t_start;
+    if (series->count >= series->capacity)
+        return;
+    series->t_usec[series->count] = timer_ticks_to_usec(t_start - series->t_begin);
+    series->latency_usec[series->count++] = latency_ns / 1000.0;
+}
+
+// Percentile of n sorted values: the value at rank floor(n * p) + 1, as in the histograms.
+static inline double series_percentile(const double *sorted, long n, double percentage)
+{
+    long rank = (long)((double)n * percentage);
+    return sorted[(rank >= n) ? n - 1 : rank];
+}
+
+// Returns -1 on allocation failure or if there would be more than SERIES_WINDOWS_MAX windows.
+static inline int series_build_windows(series_t *series)
+{
+    long w, i = 0, first;
+    double *sorted;
+    if (series->count == 0)
+        return 0;
+    if (series->kind == SERIES_ITERATIONS)
+        series->nwindows = (series->count + series->window_iterations - 1) / series->window_iterations;
+    else if (series->t_usec[series->count - 1] / series->window_usec < SERIES_WINDOWS_MAX)
+        series->nwindows = (long)(series->t_usec[series->count - 1] / series->window_usec) + 1;
+    else
+        return -1;
+    sorted = (double *)malloc(series->count * sizeof(double));
+    series->windows = (series_window_t *)calloc(series->nwindows, sizeof(series_window_t));
+    if (!sorted || !series->windows) {
+        free(sorted);
+        return -1;
+    }
+    for (w = 0; w < series->nwindows; w++)
+    {
+        series_window_t *window = &series->windows[w];
+        first = i;
+        if (series->kind == SERIES_ITERATIONS)
+            while (i < series->count && i < (w + 1) * series->window_iterations)
+                i++;
+        else
+            while (i < series->count && series->t_usec[i] < (w + 1) * series->window_usec)
+                i++;
+        window->start_usec = (series->kind == SERIES_ITERATIONS) ? series->t_usec[first] : w * series->window_usec;
+        window->count = i - first;
+        if (window->count == 0)
+            continue;
+        memcpy(sorted, series->latency_usec + first, window->count * sizeof(double));
+        qsort(sorted, window->count, sizeof(double), &stats_compare_double);
+        window->p50 = series_percentile(sorted, window->count, 0.5);
+        window->p99 = series_percentile(sorted, window->count, 0.99);
+        window->max = sorted[window->count - 1];
+    }
+    free(sorted);
+    return 0;
+}
+
+// Pearson's correlation of x and y, 0 if either is constant.
+static inline double series_pearson(const double *x, const double *y, long n)
+{
+    double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0, var_x, var_y;
+    long i;
+    for (i = 0; i < n; i++) {
+        sx += x[i];
+        sy += y[i];
+        sxx += x[i] * x[i];
+        syy += y[i] * y[i];
+        sxy += x[i] * y[i];
+    }
+    var_x = n * sxx - sx * sx;
+    var_y = n * syy - sy * sy;
+    return (var_x > 0 && var_y > 0) ? (n * sxy - sx * sy) / sqrt(var_x * var_y) : 0;
+}
+
+// Spike pairs and random pairs around bin b of lags, over bins b-1..b+1.
+static inline double series_ratio_around(const double *lags, int b, double *pairs)
+{
+    double observed = 0, expected = 0;
+    int k;
+    for (k = b - 1; k <= b + 1; k++)
+        if (k >= 0 && k < SERIES_LAG_BINS) {
+            observed += lags[k];
+            expected += lags[SERIES_LAG_BINS + k];
+        }
+    *pairs = observed;
+    return (expected > 0) ? observed / expected : 0;
+}
+
+// Up to SERIES_PERIODS peaks of the job-wide x-Random, strongest first. Peaks are local maxima; going up from
+// the shortest lag, a peak at a multiple of an accepted period is its harmonic and is left out.
+static inline void series_find_periods(series_t *series)
+{
+    const double *observed = series->job_lags, *expected = series->job_lags + SERIES_LAG_BINS;
+    double ratio[SERIES_LAG_BINS], weight, lag, multiple;
+    series_period_t candidate, *periods = series->periods;
+    int b, k, p, harmonic;
+
+    for (b = 0; b < SERIES_LAG_BINS; b++)
+        ratio[b] = (expected[b] > 0) ? observed[b] / expected[b] : 0;
+    series->nperiods = 0;
+    // Spikes are at least two bins apart
+    for (b = 2; b < SERIES_LAG_BINS - 1; b++)
+    {
+        if (ratio[b] < ratio[b - 1] || ratio[b] <= ratio[b + 1])
+            continue;
+        candidate.ratio = series_ratio_around(series->job_lags, b, &candidate.pairs);
+        candidate.pes = 0;
+        if (candidate.pairs < SERIES_PEAK_PAIRS || candidate.ratio < SERIES_PEAK_RATIO)
+            continue;
+        // Pair-weighted center of the peak
+        for (k = b - 1, weight = lag = 0; k <= b + 1; k++) {
+            weight += observed[k];
+            lag += observed[k] * (k + 0.5);
+        }
+        candidate.usec = lag / weight * series->lag_bin_usec;
+        for (p = 0, harmonic = 0; p < series->nperiods; p++) {
+            multiple = candidate.usec / periods[p].usec;
+            // The error of a period's center grows with the multiple
+            harmonic |= (fabs(multiple - floor(multiple + 0.5)) * periods[p].usec < (1 + floor(multiple + 0.5)) * series->lag_bin_usec);
+        }
+        if (harmonic)
+            continue;
+        // Keep the strongest, in descending x-Random
+        for (p = series->nperiods; p > 0 && periods[p - 1].ratio < candidate.ratio; p--)
+            if (p < SERIES_PERIODS)
+                periods[p] = periods[p - 1];
+        if (p < SERIES_PERIODS)
+            periods[p] = candidate;
+        series->nperiods += (series->nperiods < SERIES_PERIODS);
+    }
+}
+
+// Mean r of the window maxima over pairs of the (sampled) PEs, same-host pairs and cross-host pairs apart.
+static inline void series_correlate(series_t *series, const double *window_max, int num_pes, const placement_t *placements)
+{
+    long windows = (series->job_windows < SERIES_CORRELATION_WINDOWS) ? series->job_windows : SERIES_CORRELATION_WINDOWS;
+    int stride = (num_pes + SERIES_CORRELATION_PES - 1) / SERIES_CORRELATION_PES, n = 0, i, j, pe;
+    double *all = (double *)malloc((size_t)SERIES_CORRELATION_PES * windows * sizeof(double)), r, *row;
+    int *pes = (int *)malloc(SERIES_CORRELATION_PES * sizeof(int));
+    long *pairs;
+
+    series->r_same[1] = series->r_cross[1] = __DBL_MAX__;
+    series->r_same[2] = series->r_cross[2] = -__DBL_MAX__;
+    if (!all || !pes || windows < 3) {
+        free(pes);
+        free(all);
+        return;
+    }
+    for (pe = 0; pe < num_pes; pe += stride, n++) {
+        pes[n] = pe;
+        shmem_double_get(all + (size_t)n * windows, window_max, windows, pe);
+    }
+    for (i = 0; i < n; i++)
+        for (j = i + 1; j < n; j++)
+        {
+            r = series_pearson(all + (size_t)i * windows, all + (size_t)j * windows, windows);
+            row = (placements[pes[i]].host == placements[pes[j]].host) ? series->r_same : series->r_cross;
+            pairs = (row == series->r_same) ? &series->pairs_same : &series->pairs_cross;
+            row[0] += r;
+            row[1] = (r < row[1]) ? r : row[1];
+            row[2] = (r > row[2]) ? r : row[2];
+            (*pairs)++;
+        }
+    if (series->pairs_same)
+        series->r_same[0] /= series->pairs_same;
+    if (series->pairs_cross)
+        series->r_cross[0] /= series->pairs_cross;
+    free(pes);
+    free(all);
+}
+
+// Collective over all PEs, after the run: builds the windows, finds the spike periods of the job with spikes at
+// or above threshold_usec (this PE's tail percentile) and, on PE 0, the cross-PE correlation of the window
+// maxima. Returns -1 if any PE couldn't build its windows.
+static inline int series_analyze(series_t *series, double threshold_usec, const placement_t *placements)
+{
+    static long pSync1[_SHMEM_REDUCE_SYNC_SIZE], pSync2[_SHMEM_REDUCE_SYNC_SIZE];
+    static double pWrk1[_SHMEM_REDUCE_MIN_WRKDATA_SIZE], pWrk2[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static double status[4], global_status[4], present[1 + SERIES_PERIODS], job_present[1 + SERIES_PERIODS];
+    double *spikes, *window_max, tau, max_lag, n, pairs;
+    long i, j, nspikes = 0;
+    int b, p, my_pe = shmem_my_pe(), num_pes = shmem_n_pes();
+
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i++)
+        pSync1[i] = pSync2[i] = _SHMEM_SYNC_VALUE;
+    series->span_usec = series->count ? series->t_usec[series->count - 1] : 0;
+    status[0] = series_build_windows(series) ? 1 : 0;
+    status[1] = -series->span_usec;
+    status[2] = (double)series->nwindows;
+    status[3] = -(double)series->nwindows;
+    shmem_barrier_all();
+    shmem_double_max_to_all(global_status, status, 4, 0, 0, num_pes, pWrk1, pSync1);
+    if (global_status[0] != 0)
+        return -1;
+    series->job_windows = (long)-global_status[3];
+
+    // Autocorrelogram of the spike train up to a quarter of the shortest span, against uniformly random spikes
+    max_lag = -global_status[1] / 4;
+    series->lag_bin_usec = max_lag / SERIES_LAG_BINS;
+    memset(series->lags, 0, 2 * SERIES_LAG_BINS * sizeof(double));
+    spikes = (double *)malloc(SERIES_SPIKES_MAX * sizeof(double));
+    for (i = 0; spikes && i < series->count && nspikes < SERIES_SPIKES_MAX; i++)
+        if (series->latency_usec[i] >= threshold_usec &&
+            (nspikes == 0 || series->t_usec[i] - spikes[nspikes - 1] >= 2 * series->lag_bin_usec))
+            spikes[nspikes++] = series->t_usec[i];
+    series->spikes = (double)nspikes;
+    if (max_lag > 0 && series->span_usec > 0)
+    {
+        for (i = 0; i < nspikes; i++)
+            for (j = i + 1; j < nspikes && spikes[j] - spikes[i] < max_lag; j++) {
+                b = (int)((spikes[j] - spikes[i]) / series->lag_bin_usec);
+                series->lags[(b < SERIES_LAG_BINS) ? b : SERIES_LAG_BINS - 1] += 1;
+            }
+        // |t_i - t_j| of two uniform points in [0, T] has density 2 (T - tau) / T^2
+        n = (double)nspikes;
+        for (b = 0; b < SERIES_LAG_BINS; b++) {
+            tau = (b + 0.5) * series->lag_bin_usec;
+            series->lags[SERIES_LAG_BINS + b] = (tau < series->span_usec) ?
+                n * (n - 1) / 2 * 2 * (series->span_usec - tau) * series->lag_bin_usec / (series->span_usec * series->span_usec) : 0;
+        }
+    }
+    free(spikes);
+    shmem_double_sum_to_all(series->job_lags, series->lags, 2 * SERIES_LAG_BINS, 0, 0, num_pes, series->pWrk, series->pSync);
+    series->nperiods = 0;
+    if (max_lag > 0)
+        series_find_periods(series);
+
+    // Every PE checks the job's periods against its own spike train
+    present[0] = series->spikes;
+    for (p = 0; p < SERIES_PERIODS; p++)
+        present[1 + p] = (p < series->nperiods &&
+                          series_ratio_around(series->lags, (int)(series->periods[p].usec / series->lag_bin_usec), &pairs) >= SERIES_PEAK_RATIO &&
+                          pairs >= SERIES_PEAK_PAIRS);
+    shmem_double_sum_to_all(job_present, present, 1 + SERIES_PERIODS, 0, 0, num_pes, pWrk2, pSync2);
+    series->job_spikes = job_present[0];
+    for (p = 0; p < series->nperiods; p++)
+        series->periods[p].pes = (int)job_present[1 + p];
+
+    window_max = (double *)shmem_malloc((size_t)(global_status[2] > 0 ? global_status[2] : 1) * sizeof(double));
+    if (window_max)
+        for (i = 0; i < series->nwindows; i++)
+            window_max[i] = series->windows[i].max;
+    shmem_barrier_all();
+    if (my_pe == 0 && window_max)
+        series_correlate(series, window_max, num_pes, placements);
+    shmem_barrier_all();
+    if (window_max)
+        shmem_free(window_max);
+    return 0;
+}
+
+#endif /* OSHMEM_BENCH_SERIES_H */
@@ -0,0 +1,109 @@
+#ifndef OSHMEM_BENCH_STATS_H
+#define OSHMEM_BENCH_STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <shmem.h>
+
+#define STATS_METRICS_MAX               (64)
+
+// One metric of the report: this PE's value and its distribution over the PEs.
+typedef struct data{
+    double local, avg;
+    double range_from, range_to;
+    double stddev, cv, median;
+}data_t;
+
+// Every metric of a report is aggregated in one collective: the local values of all metrics are gathered
+// with a single fcollect and each PE derives min, max, mean, stddev, CV and median from the gathered table.
+// That replaces a min, a max and a sum reduction per metric, and the median needs every value anyway.
+// Reports with more than STATS_METRICS_MAX metrics go in chunks of that many.
+static double *stats_locals, *stats_all, *stats_column;
+static long stats_pSync_collect[_SHMEM_COLLECT_SYNC_SIZE];
+static long stats_pSync_barrier[_SHMEM_BARRIER_SYNC_SIZE];
+
+// Collective over all PEs.
+static inline int stats_init(void)
+{
+    int i, num_pes = shmem_n_pes();
+    for (i = 0; i < _SHMEM_COLLECT_SYNC_SIZE; i++)
+        stats_pSync_collect[i] = _SHMEM_SYNC_VALUE;
+    for (i = 0; i < _SHMEM_BARRIER_SYNC_SIZE; i++)
+        stats_pSync_barrier[i] = _SHMEM_SYNC_VALUE;
+    stats_locals = (double *)shmem_malloc(STATS_METRICS_MAX * sizeof(double));
+    stats_all = (double *)shmem_malloc((size_t)num_pes * STATS_METRICS_MAX * sizeof(double));
+    stats_column = (double *)malloc(num_pes * sizeof(double));
+    return (stats_locals && stats_all && stats_column) ? 0 : -1;
+}
+
+static inline void stats_finalize(void)
+{
+    shmem_barrier_all();
+    free(stats_column);
+    shmem_free(stats_all);
+    shmem_free(stats_locals);
+}
+
+static inline int stats_compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Welford's update, i.e. the merge of a running (count, mean, M2) with a single value.
+static inline void stats_welford(int count, double x, double *mean, double *m2)
+{
+    double delta = x - *mean;
+    *mean += delta / count;
+    *m2 += delta * (x - *mean);
+}
+
+// Collective over PEs 0..group_size-1: fills the statistics of d[0..n-1] from d[i].local of those PEs.
+// stddev is the population standard deviation over the PEs and cv = stddev / |avg|.
+static inline void stats_reduce(data_t *d, int n, int group_size)
+{
+    int first, count, i, pe;
+    double mean, m2, x;
+
+    for (first = 0; first < n; first += STATS_METRICS_MAX)
+    {
+        count = (n - first < STATS_METRICS_MAX) ? n - first : STATS_METRICS_MAX;
+        for (i = 0; i < count; i++)
+            stats_locals[i] = d[first + i].local;
+        // Nobody may still be reading stats_all from the previous call
+        shmem_barrier(0, 0, group_size, stats_pSync_barrier);
+        shmem_fcollect64(stats_all, stats_locals, count, 0, 0, group_size, stats_pSync_collect);
+
+        for (i = 0; i < count; i++)
+        {
+            data_t *s = &d[first + i];
+            mean = m2 = 0;
+            s->range_from = __DBL_MAX__;
+            s->range_to = -__DBL_MAX__;
+            for (pe = 0; pe < group_size; pe++)
+            {
+                x = stats_all[pe * count + i];
+                s->range_from = (x < s->range_from) ? x : s->range_from;
+                s->range_to = (x > s->range_to) ? x : s->range_to;
+                stats_welford(pe + 1, x, &mean, &m2);
+                stats_column[pe] = x;
+            }
+            qsort(stats_column, group_size, sizeof(double), &stats_compare_double);
+            s->avg = mean;
+            s->stddev = sqrt(m2 / group_size);
+            s->cv = (mean != 0) ? s->stddev / fabs(mean) : 0;
+            s->median = (group_size % 2) ? stats_column[group_size / 2]
+                                         : (stats_column[group_size / 2 - 1] + stats_column[group_size / 2]) / 2;
+        }
+    }
+}
+
+// One "label median/stddev/CV" entry of a "# Across PEs" line.
+static inline void stats_print_spread(FILE *stream, const char *label, const data_t *d)
+{
+    fprintf(stream, "  %s %.2f/%.2f/%.2f", label, d->median, d->stddev, d->cv);
+}
+
+#endif /* OSHMEM_BENCH_STATS_H */
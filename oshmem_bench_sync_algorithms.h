@@ -0,0 +1,269 @@
+#ifndef OSHMEM_BENCH_SYNC_ALGORITHMS_H
+#define OSHMEM_BENCH_SYNC_ALGORITHMS_H
+
+#include <string.h>
+#include <shmem.h>
+
+#define SYNC_RADIX_DEFAULT              (2)
+#define SYNC_RADIX_MAX                  (32)
+#define SYNC_MAX_ROUNDS                 (64)
+#define SYNC_GENERATION_SHIFT           (40)
+
+// User-level sync algorithms built on shmem_long_p, atomics and shmem_long_wait_until.
+// They have shmem_sync_all() semantics (no implicit shmem_quiet()) and synchronize PEs 0..group_size-1.
+//
+// Every flag is only ever written with the caller's current epoch and waited on with SHMEM_CMP_GE,
+// so flags never need to be reset and a fast PE running ahead into the next epoch can't be confused
+// with a late one. Epochs restart from a new generation whenever the group changes.
+//
+// Radix r means: dissemination talks to r-1 partners per round, the tree has r children per node,
+// the butterfly exchanges within groups of r PEs, and the tournament plays r-player matches.
+typedef struct sync_algorithm_state{
+    long *arrive;       // [SYNC_MAX_ROUNDS + 1][SYNC_RADIX_MAX], symmetric
+    long *release;      // symmetric
+    long *counter;      // symmetric, only used on PE 0
+    int my_pe, group_size, core_size, radix;
+    long generation, epoch, count;
+}sync_algorithm_state_t;
+
+typedef struct sync_algorithm{
+    const char *name;
+    void (*func_ptr)(void);
+}sync_algorithm_t;
+
+// Progress of an outstanding split-phase sync
+typedef struct sync_nb_state{
+    long epoch, step;
+    int round;
+}sync_nb_state_t;
+
+static sync_algorithm_state_t sync_algo;
+static sync_nb_state_t sync_nb;
+
+#define SYNC_ARRIVE(round, slot)        (&sync_algo.arrive[(round) * SYNC_RADIX_MAX + (slot)])
+
+// Collective over all PEs; PEs outside the group must not call the algorithms until the next change.
+static inline void sync_algorithms_set_group(int group_size)
+{
+    shmem_barrier_all();
+    sync_algo.group_size = group_size;
+    for (sync_algo.core_size = 1; sync_algo.core_size * sync_algo.radix <= group_size; )
+        sync_algo.core_size *= sync_algo.radix;
+    sync_algo.generation++;
+    sync_algo.epoch = sync_algo.generation << SYNC_GENERATION_SHIFT;
+    sync_algo.count = 0;
+    if (sync_algo.my_pe == 0)
+        *sync_algo.counter = 0;
+    shmem_barrier_all();
+}
+
+// Collective over all PEs. Returns -1 on a bad radix or allocation failure.
+static inline int sync_algorithms_init(int radix)
+{
+    size_t flags_size = (SYNC_MAX_ROUNDS + 1) * SYNC_RADIX_MAX + 2;
+    long *flags;
+
+    if (radix < 2 || radix > SYNC_RADIX_MAX)
+        return -1;
+    flags = (long *)shmem_malloc(flags_size * sizeof(long));
+    if (!flags)
+        return -1;
+    memset(flags, 0, flags_size * sizeof(long));
+    memset(&sync_algo, 0, sizeof(sync_algo));
+    sync_algo.arrive = flags;
+    sync_algo.release = flags + flags_size - 2;
+    sync_algo.counter = flags + flags_size - 1;
+    sync_algo.my_pe = shmem_my_pe();
+    sync_algo.radix = radix;
+    sync_algorithms_set_group(shmem_n_pes());
+    return 0;
+}
+
+static inline void sync_algorithms_finalize(void)
+{
+    shmem_barrier_all();
+    shmem_free(sync_algo.arrive);
+}
+
+// Every PE bumps a counter on PE 0; the PE that completes the count releases all others.
+// The counter is never reset: the last arrival of the c-th sync sees c * group_size - 1.
+// The release flag takes the place of the sense flag, with the epoch as the sense value.
+static inline void sync_central_counter(void)
+{
+    long epoch = ++sync_algo.epoch;
+    long count = ++sync_algo.count;
+    int n = sync_algo.group_size, pe;
+
+    if (shmem_long_atomic_fetch_inc(sync_algo.counter, 0) == count * n - 1) {
+        for (pe = 0; pe < n; pe++)
+            if (pe != sync_algo.my_pe)
+                shmem_long_p(sync_algo.release, epoch, pe);
+    }
+    else
+        shmem_long_wait_until(sync_algo.release, SHMEM_CMP_GE, epoch);
+}
+
+// Round r: notify the PEs at distance j * radix^r (j = 1..radix-1) and wait for the mirror images.
+static inline void sync_dissemination(void)
+{
+    long epoch = ++sync_algo.epoch;
+    int n = sync_algo.group_size, k = sync_algo.radix, p = sync_algo.my_pe;
+    long step;
+    int r, j;
+
+    for (r = 0, step = 1; step < n; r++, step *= k)
+    {
+        for (j = 1; j < k && j * step < n; j++)
+            shmem_long_p(SYNC_ARRIVE(r, j), epoch, (int)((p + j * step) % n));
+        for (j = 1; j < k && j * step < n; j++)
+            shmem_long_wait_until(SYNC_ARRIVE(r, j), SHMEM_CMP_GE, epoch);
+    }
+}
+
+// Fan-in to PE 0 along a radix-ary tree, then fan-out along the same tree.
+static inline void sync_kary_tree(void)
+{
+    long epoch = ++sync_algo.epoch;
+    int n = sync_algo.group_size, k = sync_algo.radix, p = sync_algo.my_pe;
+    long first_child = (long)p * k + 1;
+    int c;
+
+    for (c = 0; c < k && first_child + c < n; c++)
+        shmem_long_wait_until(SYNC_ARRIVE(0, c), SHMEM_CMP_GE, epoch);
+    if (p != 0) {
+        shmem_long_p(SYNC_ARRIVE(0, (p - 1) % k), epoch, (p - 1) / k);
+        shmem_long_wait_until(sync_algo.release, SHMEM_CMP_GE, epoch);
+    }
+    for (c = 0; c < k && first_child + c < n; c++)
+        shmem_long_p(sync_algo.release, epoch, (int)(first_child + c));
+}
+
+// Recursive doubling generalized to radix-ary digits over the largest power of radix (core_size)
+// that fits in the group. PEs beyond the core fold into core PE (p % core_size) before the
+// exchange and are released by it afterwards.
+static inline void sync_butterfly(void)
+{
+    long epoch = ++sync_algo.epoch;
+    int n = sync_algo.group_size, k = sync_algo.radix, p = sync_algo.my_pe, core = sync_algo.core_size;
+    long step;
+    int r, j;
+
+    if (p >= core) {
+        shmem_long_p(SYNC_ARRIVE(0, p / core), epoch, p % core);
+        shmem_long_wait_until(sync_algo.release, SHMEM_CMP_GE, epoch);
+        return;
+    }
+    for (j = 1; j < k && p + (long)j * core < n; j++)
+        shmem_long_wait_until(SYNC_ARRIVE(0, j), SHMEM_CMP_GE, epoch);
+
+    for (r = 1, step = 1; step < core; r++, step *= k)
+    {
+        int digit = (int)((p / step) % k);
+        for (j = 1; j < k; j++) {
+            int partner_digit = (digit + j) % k;
+            shmem_long_p(SYNC_ARRIVE(r, k - j), epoch, (int)(p + (partner_digit - digit) * step));
+        }
+        for (j = 1; j < k; j++)
+            shmem_long_wait_until(SYNC_ARRIVE(r, j), SHMEM_CMP_GE, epoch);
+    }
+
+    for (j = 1; j < k && p + (long)j * core < n; j++)
+        shmem_long_p(sync_algo.release, epoch, (int)(p + (long)j * core));
+}
+
+// Statically scheduled tournament: in round r the PE at a multiple of radix^(r+1) wins against the
+// PEs at j * radix^r past it. Losers wait to be woken up by their winner; PE 0 is the champion.
+// Wake-up runs in reverse round order, each PE waking the PEs it has beaten.
+static inline void sync_tournament(void)
+{
+    long epoch = ++sync_algo.epoch;
+    int n = sync_algo.group_size, k = sync_algo.radix, p = sync_algo.my_pe;
+    long step;
+    int r, j, rounds_won;
+
+    for (r = 0, step = 1; step < n; r++, step *= k)
+    {
+        if (p % (step * k) != 0) {
+            shmem_long_p(SYNC_ARRIVE(r, (p % (step * k)) / step), epoch, (int)(p - p % (step * k)));
+            shmem_long_wait_until(sync_algo.release, SHMEM_CMP_GE, epoch);
+            break;
+        }
+        for (j = 1; j < k && p + j * step < n; j++)
+            shmem_long_wait_until(SYNC_ARRIVE(r, j), SHMEM_CMP_GE, epoch);
+    }
+    rounds_won = r;
+
+    for (r = rounds_won - 1, step /= k; r >= 0; r--, step /= k)
+        for (j = 1; j < k && p + j * step < n; j++)
+            shmem_long_p(sync_algo.release, epoch, (int)(p + j * step));
+}
+
+// Split-phase dissemination: post() sends the first round, test() advances through every round whose
+// notifications have already arrived without blocking, and wait() blocks until the last round is done.
+// At most one split-phase sync may be outstanding, and no blocking algorithm may run meanwhile.
+static inline void sync_nb_send_round(void)
+{
+    int n = sync_algo.group_size, k = sync_algo.radix, p = sync_algo.my_pe, j;
+    for (j = 1; j < k && j * sync_nb.step < n; j++)
+        shmem_long_p(SYNC_ARRIVE(sync_nb.round, j), sync_nb.epoch, (int)((p + j * sync_nb.step) % n));
+}
+
+static inline void sync_nb_post(void)
+{
+    sync_nb.epoch = ++sync_algo.epoch;
+    sync_nb.round = 0;
+    sync_nb.step = 1;
+    if (sync_nb.step < sync_algo.group_size)
+        sync_nb_send_round();
+}
+
+// Returns 1 once the sync is complete.
+static inline int sync_nb_test(void)
+{
+    int n = sync_algo.group_size, k = sync_algo.radix, j;
+    while (sync_nb.step < n)
+    {
+        for (j = 1; j < k && j * sync_nb.step < n; j++)
+            if (!shmem_long_test(SYNC_ARRIVE(sync_nb.round, j), SHMEM_CMP_GE, sync_nb.epoch))
+                return 0;
+        sync_nb.round++;
+        sync_nb.step *= k;
+        if (sync_nb.step < n)
+            sync_nb_send_round();
+    }
+    return 1;
+}
+
+static inline void sync_nb_wait(void)
+{
+    int n = sync_algo.group_size, k = sync_algo.radix, j;
+    while (sync_nb.step < n)
+    {
+        for (j = 1; j < k && j * sync_nb.step < n; j++)
+            shmem_long_wait_until(SYNC_ARRIVE(sync_nb.round, j), SHMEM_CMP_GE, sync_nb.epoch);
+        sync_nb.round++;
+        sync_nb.step *= k;
+        if (sync_nb.step < n)
+            sync_nb_send_round();
+    }
+}
+
+static const sync_algorithm_t sync_algorithms[] = {
+    { "central_counter", &sync_central_counter },
+    { "dissemination"  , &sync_dissemination },
+    { "tree"           , &sync_kary_tree },
+    { "butterfly"      , &sync_butterfly },
+    { "tournament"     , &sync_tournament },
+    { NULL, NULL }
+};
+
+static inline const sync_algorithm_t* sync_algorithm_find(const char *name)
+{
+    const sync_algorithm_t *algo;
+    for (algo = sync_algorithms; algo->name; algo++)
+        if (strcmp(algo->name, name) == 0)
+            return algo;
+    return NULL;
+}
+
+#endif /* OSHMEM_BENCH_SYNC_ALGORITHMS_H */
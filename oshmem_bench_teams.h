@@ -0,0 +1,123 @@
+#ifndef OSHMEM_BENCH_TEAMS_H
+#define OSHMEM_BENCH_TEAMS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shmem.h>
+
+// Teams (shmem_team_split_*, shmem_team_sync, team-based reductions) are OpenSHMEM 1.5 API.
+// Against an older library only the option parsing below is compiled.
+#if SHMEM_MAJOR_VERSION > 1 || (SHMEM_MAJOR_VERSION == 1 && SHMEM_MINOR_VERSION >= 5)
+#define HAVE_SHMEM_TEAMS                (1)
+#else
+#define HAVE_SHMEM_TEAMS                (0)
+#endif
+
+#define TEAM_SETS_MAX                   (2)
+
+// How the world team is cut into sub-teams:
+//   shared        : one team per node (SHMEM_TEAM_SHARED)
+//   strided:SIZE  : consecutive blocks of SIZE PEs, built with one shmem_team_split_strided() per block
+//   2d:XRANGE     : rows of XRANGE PEs and the matching columns, built with shmem_team_split_2d()
+// Every split is a partition of the world team, so the teams of one set are disjoint.
+typedef enum team_split_kind{
+    TEAM_SPLIT_NONE = 0,
+    TEAM_SPLIT_SHARED,
+    TEAM_SPLIT_STRIDED,
+    TEAM_SPLIT_2D
+}team_split_kind_t;
+
+typedef struct team_split{
+    team_split_kind_t kind;
+    int param;
+    int concurrent;     // all teams of a set sync at the same moment instead of one team at a time
+}team_split_t;
+
+static inline int team_split_parse(const char *str, team_split_t *split)
+{
+    if (strcmp(str, "shared") == 0) {
+        split->kind = TEAM_SPLIT_SHARED;
+        split->param = 0;
+        return 0;
+    }
+    if (strncmp(str, "strided:", 8) == 0) {
+        split->kind = TEAM_SPLIT_STRIDED;
+        split->param = atoi(str + 8);
+    }
+    else if (strncmp(str, "2d:", 3) == 0) {
+        split->kind = TEAM_SPLIT_2D;
+        split->param = atoi(str + 3);
+    }
+    else
+        return -1;
+    return (split->param < 1) ? -1 : 0;
+}
+
+#if HAVE_SHMEM_TEAMS
+// One set of disjoint teams as seen from this PE: its own team and the world PE that leads it.
+typedef struct team_set{
+    char name[30];
+    shmem_team_t team;
+    int leader;
+    int owned;          // created by team_sets_create(), destroyed by team_sets_destroy()
+}team_set_t;
+
+static inline void team_set_assign(team_set_t *set, const char *name, shmem_team_t team, int owned)
+{
+    strcpy(set->name, name);
+    set->team = team;
+    set->leader = shmem_team_translate_pe(team, 0, SHMEM_TEAM_WORLD);
+    set->owned = owned;
+}
+
+// Collective over the world team. Returns the number of sets (at most TEAM_SETS_MAX) or -1 on failure.
+static inline int team_sets_create(const team_split_t *split, team_set_t *sets)
+{
+    int my_pe = shmem_my_pe(), num_pes = shmem_n_pes();
+    shmem_team_t team, xteam, yteam;
+    int start, size;
+
+    switch (split->kind)
+    {
+    case TEAM_SPLIT_SHARED:
+        team_set_assign(&sets[0], "shared", SHMEM_TEAM_SHARED, 0);
+        return 1;
+
+    case TEAM_SPLIT_STRIDED:
+        // Every PE takes part in every split; only members of the block get a valid handle back
+        sets[0].team = SHMEM_TEAM_INVALID;
+        for (start = 0; start < num_pes; start += split->param)
+        {
+            size = (num_pes - start < split->param) ? num_pes - start : split->param;
+            if (shmem_team_split_strided(SHMEM_TEAM_WORLD, start, 1, size, NULL, 0, &team) != 0)
+                return -1;
+            if (my_pe >= start && my_pe < start + size)
+                team_set_assign(&sets[0], "strided", team, 1);
+        }
+        return (sets[0].team == SHMEM_TEAM_INVALID) ? -1 : 1;
+
+    case TEAM_SPLIT_2D:
+        if (shmem_team_split_2d(SHMEM_TEAM_WORLD, split->param, NULL, 0, &xteam, NULL, 0, &yteam) != 0 ||
+            xteam == SHMEM_TEAM_INVALID || yteam == SHMEM_TEAM_INVALID)
+            return -1;
+        team_set_assign(&sets[0], "row", xteam, 1);
+        team_set_assign(&sets[1], "column", yteam, 1);
+        return 2;
+
+    default:
+        return -1;
+    }
+}
+
+static inline void team_sets_destroy(team_set_t *sets, int count)
+{
+    int i;
+    shmem_barrier_all();
+    for (i = 0; i < count; i++)
+        if (sets[i].owned)
+            shmem_team_destroy(sets[i].team);
+}
+#endif /* HAVE_SHMEM_TEAMS */
+
+#endif /* OSHMEM_BENCH_TEAMS_H */
@@ -0,0 +1,242 @@
+#ifndef OSHMEM_BENCH_TIMER_H
+#define OSHMEM_BENCH_TIMER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TIMER_HAVE_CYCLE_COUNTER        (1)
+#elif defined(__aarch64__)
+#define TIMER_HAVE_CYCLE_COUNTER        (1)
+#else
+#define TIMER_HAVE_CYCLE_COUNTER        (0)
+#endif
+
+#define TIMER_CALIBRATION_NSEC          (50 * 1000 * 1000)
+#define TIMER_COST_READS                (100000)
+
+// Time-stamp sources selectable with -T.
+// All of them are read through timer_read() and converted with timer_ticks_to_usec(),
+// so the benchmarks don't care which one is active.
+typedef enum timer_kind{
+    TIMER_RDTSC = 0,
+    TIMER_MONOTONIC_RAW,
+    TIMER_GETTIMEOFDAY
+}timer_kind_t;
+
+typedef struct timer_info{
+    timer_kind_t kind;
+    char name[30];
+    double ticks_per_usec;
+    double resolution_ns;
+    double read_cost_ns;
+    int tsc_invariant;
+}timer_info_t;
+
+static timer_info_t bench_timer = { TIMER_MONOTONIC_RAW, "monotonic_raw", 1000.0, 0, 0, 0 };
+
+static inline uint64_t timer_read_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t retval;
+    // lfence on both sides keeps the measured code from leaking out of the timed region
+    _mm_lfence();
+    retval = __rdtsc();
+    _mm_lfence();
+    return retval;
+#elif defined(__aarch64__)
+    uint64_t retval;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(retval) :: "memory");
+    return retval;
+#else
+    return 0;
+#endif
+}
+
+static inline uint64_t timer_read_monotonic_raw(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts))
+    {
+        perror("clock_gettime");
+        abort();
+    }
+    return ((uint64_t)ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint64_t timer_read_gettimeofday(void)
+{
+    struct timeval tv;
+    if (gettimeofday(&tv, NULL))
+    {
+        perror("gettimeofday");
+        abort();
+    }
+    return ((uint64_t)tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+// Returns a time stamp in ticks of the active timer.
+static inline uint64_t timer_read(void)
+{
+    switch (bench_timer.kind)
+    {
+    case TIMER_RDTSC:
+        return timer_read_cycles();
+    case TIMER_GETTIMEOFDAY:
+        return timer_read_gettimeofday();
+    default:
+        return timer_read_monotonic_raw();
+    }
+}
+
+static inline double timer_ticks_to_usec(int64_t ticks)
+{
+    return (double)ticks / bench_timer.ticks_per_usec;
+}
+
+static inline double timer_ticks_to_nsec(int64_t ticks)
+{
+    return (double)ticks * 1000.0 / bench_timer.ticks_per_usec;
+}
+
+static inline int timer_parse(const char *str, timer_kind_t *kind)
+{
+    if (strcmp(str, "rdtsc") == 0)
+        *kind = TIMER_RDTSC;
+    else if (strcmp(str, "monotonic_raw") == 0)
+        *kind = TIMER_MONOTONIC_RAW;
+    else if (strcmp(str, "gettimeofday") == 0)
+        *kind = TIMER_GETTIMEOFDAY;
+    else
+        return -1;
+    return 0;
+}
+
+// A TSC that stops or changes rate with P/C-states is useless for timing.
+// On aarch64 the generic timer always runs at a constant rate.
+static inline int timer_cycles_invariant(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return (edx & (1 << 8)) != 0;
+#elif defined(__aarch64__)
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+// Calibrates the cycle counter against CLOCK_MONOTONIC_RAW.
+// Each reference point is taken as the tightest of several back-to-back read pairs.
+static inline double timer_calibrate_cycles(void)
+{
+#if defined(__aarch64__)
+    uint64_t freq;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(freq));
+    if (freq)
+        return (double)freq / 1e6;
+#endif
+    uint64_t c_start = 0, c_stop = 0, ns_start = 0, ns_stop = 0, now;
+    uint64_t best, c0, c1, ns;
+    int i;
+
+    best = UINT64_MAX;
+    for (i = 0; i < 10; i++) {
+        c0 = timer_read_cycles();
+        ns = timer_read_monotonic_raw();
+        c1 = timer_read_cycles();
+        if (c1 - c0 < best) {
+            best = c1 - c0;
+            c_start = c0 + (c1 - c0) / 2;
+            ns_start = ns;
+        }
+    }
+    do {
+        now = timer_read_monotonic_raw();
+    } while (now - ns_start < TIMER_CALIBRATION_NSEC);
+    best = UINT64_MAX;
+    for (i = 0; i < 10; i++) {
+        c0 = timer_read_cycles();
+        ns = timer_read_monotonic_raw();
+        c1 = timer_read_cycles();
+        if (c1 - c0 < best) {
+            best = c1 - c0;
+            c_stop = c0 + (c1 - c0) / 2;
+            ns_stop = ns;
+        }
+    }
+    return (double)(c_stop - c_start) * 1000.0 / (double)(ns_stop - ns_start);
+}
+
+// Measures the smallest observable step and the average cost of one timer_read().
+static inline void timer_measure(void)
+{
+    uint64_t t_prev, t_curr, t_start, min_step = UINT64_MAX;
+    int i;
+
+    t_start = t_prev = timer_read();
+    for (i = 0; i < TIMER_COST_READS; i++)
+    {
+        t_curr = timer_read();
+        if (t_curr != t_prev && t_curr - t_prev < min_step)
+            min_step = t_curr - t_prev;
+        t_prev = t_curr;
+    }
+    bench_timer.read_cost_ns = timer_ticks_to_nsec(t_prev - t_start) / TIMER_COST_READS;
+    bench_timer.resolution_ns = (min_step == UINT64_MAX) ? 0 : timer_ticks_to_nsec(min_step);
+}
+
+// Selects and calibrates the time-stamp source. Has to be called on every PE before timer_read().
+// Falls back to monotonic_raw when no invariant cycle counter is available.
+// Returns 0 on success, or 1 when the requested timer was replaced by the fallback.
+static inline int timer_init(timer_kind_t kind)
+{
+    int retval = 0;
+
+    bench_timer.tsc_invariant = timer_cycles_invariant();
+    if (kind == TIMER_RDTSC && !(TIMER_HAVE_CYCLE_COUNTER && bench_timer.tsc_invariant))
+    {
+        kind = TIMER_MONOTONIC_RAW;
+        retval = 1;
+    }
+
+    bench_timer.kind = kind;
+    switch (kind)
+    {
+    case TIMER_RDTSC:
+        strcpy(bench_timer.name, "rdtsc");
+        bench_timer.ticks_per_usec = timer_calibrate_cycles();
+        break;
+    case TIMER_GETTIMEOFDAY:
+        strcpy(bench_timer.name, "gettimeofday");
+        bench_timer.ticks_per_usec = 1.0;
+        break;
+    default:
+        strcpy(bench_timer.name, "monotonic_raw");
+        bench_timer.ticks_per_usec = 1000.0;
+        break;
+    }
+    timer_measure();
+    return retval;
+}
+
+static inline void timer_print_info(FILE *stream, int my_pe)
+{
+    if (my_pe == 0) {
+        fprintf(stream, "# Timer: %s", bench_timer.name);
+        if (bench_timer.kind == TIMER_RDTSC)
+            fprintf(stream, " (%s, %.3f GHz)", bench_timer.tsc_invariant ? "invariant" : "NOT invariant",
+                    bench_timer.ticks_per_usec / 1000.0);
+        fprintf(stream, ", resolution %.2f ns, read cost %.2f ns\n", bench_timer.resolution_ns, bench_timer.read_cost_ns);
+    }
+}
+
+#endif /* OSHMEM_BENCH_TIMER_H */
@@ -0,0 +1,126 @@
+#ifndef OSHMEM_BENCH_TRACE_H
+#define OSHMEM_BENCH_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <shmem.h>
+#include "oshmem_bench_timer.h"
+#include "oshmem_bench_clock.h"
+
+#define TRACE_STAMPS                    (4)
+#define TRACE_PATH_MAX                  (256)
+#define TRACE_WRITE_BUFFER              (1 << 20)
+
+// Per-PE timeline of the measured iterations, written as Chrome trace JSON (which Perfetto opens as well).
+// Every iteration keeps the start of its pre_func, the start and the end of the timed region and the noise
+// injected at its beginning, in a buffer allocated up front; nothing is formatted before the run is over.
+// At the end every PE maps its stamps onto PE 0's timeline and writes PREFIX.PE.json, with one track per PE:
+// the pre_func, the injected noise and the measured call as complete ("X") events, skip iterations in
+// category "skip". The files of a job merge into one trace with
+//   jq -s '{traceEvents: map(.traceEvents) | add}' PREFIX.*.json
+typedef struct trace{
+    char prefix[TRACE_PATH_MAX];
+    uint64_t *stamps;           // [capacity][TRACE_STAMPS]: pre_func start, timed start, timed stop, injected ns
+    long count, capacity;
+    int skip;                   // leading iterations that were skipped
+}trace_t;
+
+static inline int trace_parse(const char *str, trace_t *trace)
+{
+    memset(trace, 0, sizeof(*trace));
+    if (strlen(str) == 0 || strlen(str) >= TRACE_PATH_MAX - 16)
+        return -1;
+    strcpy(trace->prefix, str);
+    return 0;
+}
+
+// Collective over all PEs, has to be called after timer_init(): starts the clock model for the timeline.
+// Returns -1 on allocation failure on this PE only; the caller has to agree on it with the others.
+static inline int trace_init(trace_t *trace, long capacity, int skip)
+{
+    trace->capacity = capacity;
+    trace->skip = skip;
+    trace->count = 0;
+    trace->stamps = (uint64_t *)malloc(capacity * TRACE_STAMPS * sizeof(uint64_t));
+    clock_sync_init(CLOCK_SYNC_ROUNDS_DEFAULT);
+    return trace->stamps ? 0 : -1;
+}
+
+static inline void trace_destroy(trace_t *trace)
+{
+    free(trace->stamps);
+    trace->stamps = NULL;
+}
+
+// Called for every iteration, skip iterations included.
+static inline void trace_record(trace_t *trace, uint64_t t_pre, uint64_t t_start, uint64_t t_stop, int64_t injected_ns)
+{
+    uint64_t *s;
+    if (trace->count >= trace->capacity)
+        return;
+    s = &trace->stamps[trace->count++ * TRACE_STAMPS];
+    s[0] = t_pre;
+    s[1] = t_start;
+    s[2] = t_stop;
+    s[3] = (uint64_t)injected_ns;
+}
+
+static inline double trace_global_usec(uint64_t ticks)
+{
+    return clock_global_ns(clock_ticks_to_local_ns(ticks)) / 1000.0;
+}
+
+static inline void trace_write_event(FILE *file, const char *name, const char *cat, int pe, double ts, double dur, long iteration)
+{
+    fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"iteration\":%ld}}",
+            name, cat, pe, ts, (dur > 0) ? dur : 0, iteration);
+}
+
+// Collective over all PEs: refreshes the clock model (which also yields the drift) and writes this PE's file.
+// Returns -1 if the file can't be written.
+static inline int trace_write(trace_t *trace, int my_pe, const char *func_name, const char *pre_name)
+{
+    char path[TRACE_PATH_MAX + 32], hostname[64];
+    char *buffer = (char *)malloc(TRACE_WRITE_BUFFER);
+    double t_pre, t_start, t_stop, injected_usec;
+    const char *cat;
+    FILE *file;
+    long i;
+    int retval;
+
+    clock_sync_update(CLOCK_SYNC_ROUNDS_DEFAULT);
+    snprintf(path, sizeof(path), "%s.%d.json", trace->prefix, my_pe);
+    if ((file = fopen(path, "w")) == NULL) {
+        free(buffer);
+        return -1;
+    }
+    if (buffer)
+        setvbuf(file, buffer, _IOFBF, TRACE_WRITE_BUFFER);
+    gethostname(hostname, sizeof(hostname));
+    hostname[sizeof(hostname) - 1] = '\0';
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"PE %d (%s)\"}},\n", my_pe, my_pe, hostname);
+    fprintf(file, "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"sort_index\":%d}}", my_pe, my_pe);
+    for (i = 0; i < trace->count; i++)
+    {
+        const uint64_t *s = &trace->stamps[i * TRACE_STAMPS];
+        cat = (i < trace->skip) ? "skip" : "sync";
+        t_pre = trace_global_usec(s[0]);
+        t_start = trace_global_usec(s[1]);
+        t_stop = trace_global_usec(s[2]);
+        injected_usec = s[3] / 1000.0;
+        trace_write_event(file, pre_name, cat, my_pe, t_pre, t_start - t_pre, i);
+        if (injected_usec > 0)
+            trace_write_event(file, "noise", cat, my_pe, t_start, injected_usec, i);
+        trace_write_event(file, func_name, cat, my_pe, t_start + injected_usec, t_stop - t_start - injected_usec, i);
+    }
+    fprintf(file, "\n]}\n");
+    retval = (fclose(file) == 0) ? 0 : -1;
+    free(buffer);
+    return retval;
+}
+
+#endif /* OSHMEM_BENCH_TRACE_H */
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <sys/time.h>
 #include <stdint.h>
@@ -8,101 +9,343 @@
 #include <math.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <getopt.h>
+#include "oshmem_bench_timer.h"
+#include "oshmem_bench_sync_algorithms.h"
+#include "oshmem_bench_compute.h"
+#include "oshmem_bench_scale.h"
+#include "oshmem_bench_affinity.h"
+#include "oshmem_bench_stats.h"
 
 #define BENCHMARK                       "OpenSHMEM overlap benchmark for sync operation"
 #define SKIP_DEFAULT                    (200)
 #define ITERATIONS_DEFAULT              (100000)
 #define KB                              (1024)
 #define MB                              (1024*KB)
-#define COMPUTE_BUFFER_SIZE             (512)
+#define MIN_COMPUTE_FACTOR              (0.5)
+#define MAX_COMPUTE_FACTOR_DEFAULT      (16)
+#define MAX_POLLS_DEFAULT               (16)
 
 
 // SHMEM API version 1.4 doesn't support non-blocking sync operation!
 // Thus, I had to add it by myself...
-void shmem_sync_all_post(void);
-void shmem_sync_all_wait(void);
+// The symbols are weak, so on libraries without them the built-in split-phase dissemination is used instead.
+void shmem_sync_all_post(void) __attribute__((weak));
+void shmem_sync_all_wait(void) __attribute__((weak));
 
+typedef struct nb_sync{
+    void (*post)(void);
+    void (*wait)(void);
+    int (*test)(void);
+    char name[30];
+}nb_sync_t;
 
-typedef struct data{
-    double local, avg;
-    double range_from, range_to;
-}data_t;
 
-int64_t get_microsec_time_stamp()
+// What drives the progress of the outstanding sync while the compute kernel runs.
+//   none   : nothing, the sync only progresses in post/wait (and in the library, if it has its own engine)
+//   poll   : the compute phase is split into chunks and the progress hook is called between chunks
+//   thread : a pinned helper thread calls the progress hook every poll interval
+typedef enum progress_mode{
+    PROGRESS_NONE = 0,
+    PROGRESS_POLL,
+    PROGRESS_THREAD
+}progress_mode_t;
+
+#define PROGRESS_IDLE                   (0)
+#define PROGRESS_ACTIVE                 (1)
+#define PROGRESS_EXIT                   (2)
+
+typedef struct progress_thread{
+    pthread_t thread;
+    nb_sync_t *sync;
+    int command, done, cpu, started;
+    uint64_t interval_ticks;
+}progress_thread_t;
+
+// The progress hook: test() for the builtin sync, shmem_quiet() as the generic library poke otherwise
+static inline int progress_hook(nb_sync_t* sync)
 {
-    int64_t retval;
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL))
+    if (sync->test)
+        return sync->test();
+    shmem_quiet();
+    return 0;
+}
+
+// For the builtin sync the helper thread owns the sync state between post and completion:
+// it calls test() until the sync is done and then hands it back through "done".
+// For the vendor sync it just keeps poking the library until the main thread's wait returns.
+void* progress_thread_main(void *arg)
+{
+    progress_thread_t *pt = (progress_thread_t *)arg;
+    int command;
+
+    while ((command = __atomic_load_n(&pt->command, __ATOMIC_ACQUIRE)) != PROGRESS_EXIT)
     {
-        perror("gettimeofday");
-        abort();
+        uint64_t t_start;
+        if (command != PROGRESS_ACTIVE) {
+            sched_yield();
+            continue;
+        }
+        if (progress_hook(pt->sync)) {
+            __atomic_store_n(&pt->command, PROGRESS_IDLE, __ATOMIC_RELAXED);
+            __atomic_store_n(&pt->done, 1, __ATOMIC_RELEASE);
+            continue;
+        }
+        t_start = timer_read();
+        while (timer_read() - t_start < pt->interval_ticks)
+            ;
     }
-    retval = ((int64_t)tv.tv_sec) * 1000000 + tv.tv_usec;
+    return NULL;
+}
+
+// Picks the CPU for this PE's progress thread by its rank among the PEs on the same host: the local_rank-th
+// CPU that no PE of the host runs its main thread on, from this PE's affinity mask or, if the mask has too few
+// (e.g. under per-core binding), from all online CPUs. Returns -1 if the host has fewer free CPUs than PEs.
+int progress_thread_default_cpu(const placement_t *placements, int my_pe, int num_pes)
+{
+    cpu_set_t set, used;
+    int cpu, pe, pass, free_cpus, local_rank = 0, online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    CPU_ZERO(&used);
+    for (pe = 0; pe < num_pes; pe++)
+        if (placements[pe].host == placements[my_pe].host)
+        {
+            if (placements[pe].cpu >= 0 && placements[pe].cpu < CPU_SETSIZE)
+                CPU_SET(placements[pe].cpu, &used);
+            local_rank += (pe < my_pe);
+        }
+    if (sched_getaffinity(0, sizeof(set), &set))
+        CPU_ZERO(&set);
+    for (pass = 0; pass < 2; pass++)
+        for (cpu = 0, free_cpus = 0; cpu < CPU_SETSIZE; cpu++)
+            if (!CPU_ISSET(cpu, &used) && (pass ? cpu < online : CPU_ISSET(cpu, &set)) && free_cpus++ == local_rank)
+                return cpu;
+    return -1;
+}
+
+// Collective over all PEs: nonzero if failed is nonzero on any PE
+int any_pe_failed(int failed)
+{
+    static long pSync[_SHMEM_REDUCE_SYNC_SIZE];
+    static int pWrk[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static int local, global;
+    int i;
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i++)
+        pSync[i] = _SHMEM_SYNC_VALUE;
+    local = failed;
+    shmem_barrier_all();
+    shmem_int_max_to_all(&global, &local, 1, 0, 0, shmem_n_pes(), pWrk, pSync);
+    return global;
+}
+
+// The thread is created on its CPU, so a CPU outside the allowed set fails here instead of going unnoticed
+int progress_thread_start(progress_thread_t *pt, nb_sync_t *sync, int cpu)
+{
+    pthread_attr_t attr;
+    cpu_set_t set;
+    int retval;
+    memset(pt, 0, sizeof(*pt));
+    pt->sync = sync;
+    pt->cpu = cpu;
+    CPU_ZERO(&set);
+    CPU_SET(pt->cpu, &set);
+    if (pthread_attr_init(&attr))
+        return -1;
+    retval = pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    if (retval == 0)
+        retval = pthread_create(&pt->thread, &attr, &progress_thread_main, pt);
+    pthread_attr_destroy(&attr);
     return retval;
 }
 
-void swap(volatile double *volatile xp, volatile double *volatile yp)
+void progress_thread_stop(progress_thread_t *pt)
 {
-    double temp = *xp;
-    *xp = *yp;
-    *yp = temp;
+    __atomic_store_n(&pt->command, PROGRESS_EXIT, __ATOMIC_RELEASE);
+    pthread_join(pt->thread, NULL);
 }
- 
-void computation_func(volatile double *volatile computation_arr, int computation_amount)
+
+void computation_func(long computation_amount)
 {
-    //Bubble sort
-    int i, j;
-    for (i = 0; i < computation_amount-1; i++)     
-       // Last i elements are already in place  
-       for (j = 0; j < computation_amount-i-1; j++)
-           if (computation_arr[j] > computation_arr[j+1])
-              swap(&computation_arr[j], &computation_arr[j+1]);
+    if (computation_amount > 0)
+        compute_run(computation_amount);
 }
 
-double computation_latency(volatile double *volatile computation_arr, int computation_amount, int iterations, int skip)
+double computation_latency(long computation_amount, int iterations, int skip)
 {
-    int64_t t_start, t_stop;
+    uint64_t t_start, t_stop;
     int i;
     for (i = 0; i < skip; i++)
-        computation_func(computation_arr, computation_amount);
-    t_start = get_microsec_time_stamp();
+        computation_func(computation_amount);
+    t_start = timer_read();
     for (i = 0; i < iterations; i++)
-        computation_func(computation_arr, computation_amount);
-    t_stop = get_microsec_time_stamp();
-    return (double)(t_stop - t_start) / (double)iterations;
+        computation_func(computation_amount);
+    t_stop = timer_read();
+    return timer_ticks_to_usec(t_stop - t_start) / (double)iterations;
 }
 
-double computation_and_networking_latency(volatile double *volatile computation_arr, int computation_amount, int iterations, int skip)
+// One overlapped step: post, compute in "polls" chunks with the progress hook between them (poll mode),
+// or hand progress to the helper thread for the duration of the compute (thread mode), then wait.
+static inline void overlapped_step(nb_sync_t* sync, long computation_amount, progress_mode_t mode, int polls, progress_thread_t* pt)
 {
-    int64_t t_start, t_stop;
+    int chunk;
+    sync->post();
+    switch (mode)
+    {
+    case PROGRESS_POLL:
+        for (chunk = 0; chunk < polls; chunk++)
+        {
+            if (chunk > 0)
+                progress_hook(sync);
+            computation_func(computation_amount * (chunk + 1) / polls - computation_amount * chunk / polls);
+        }
+        sync->wait();
+        break;
+    case PROGRESS_THREAD:
+        if (sync->test) {
+            __atomic_store_n(&pt->done, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&pt->command, PROGRESS_ACTIVE, __ATOMIC_RELEASE);
+            computation_func(computation_amount);
+            while (!__atomic_load_n(&pt->done, __ATOMIC_ACQUIRE))
+                ;
+        }
+        else {
+            __atomic_store_n(&pt->command, PROGRESS_ACTIVE, __ATOMIC_RELEASE);
+            computation_func(computation_amount);
+            sync->wait();
+            __atomic_store_n(&pt->command, PROGRESS_IDLE, __ATOMIC_RELEASE);
+        }
+        break;
+    default:
+        computation_func(computation_amount);
+        sync->wait();
+        break;
+    }
+}
+
+double computation_and_networking_latency(nb_sync_t* sync, void (*pre_func)(void), long computation_amount, progress_mode_t mode, int polls, progress_thread_t* pt,
+                                          int iterations, int skip)
+{
+    uint64_t t_start, t_stop;
     int i;
     for (i = 0; i < skip; i++)
-    {
-        shmem_sync_all_post();
-        computation_func(computation_arr, computation_amount);
-        shmem_sync_all_wait();
-    }    
-    shmem_barrier_all();
-    t_start = get_microsec_time_stamp();
+        overlapped_step(sync, computation_amount, mode, polls, pt);
+    pre_func();
+    t_start = timer_read();
     for (i = 0; i < iterations; i++)
+        overlapped_step(sync, computation_amount, mode, polls, pt);
+    t_stop = timer_read();
+    return timer_ticks_to_usec(t_stop - t_start) / (double)iterations;
+}
+
+// Measures the network latency of PEs 0..group_size-1 and prints one row per compute factor (and poll count).
+// Called by the PEs of the group only; align is their barrier. Returns the group's average network latency.
+// From verbosity level 1 on, every row is followed by the spread of its metrics over the PEs.
+double run_overlap_table(FILE *stream, int my_pe, int group_size, void (*align)(void), nb_sync_t* sync, progress_mode_t mode,
+                         int max_polls, progress_thread_t* pt, double max_factor, int iterations, int skip, int verbosity_level)
+{
+    static data_t compute, network, step[3];
+    data_t *overall = &step[0], *overhead = &step[1], *availability = &step[2];
+    double factor;
+    long computation_amount;
+    int polls;
+
+    align();
+
+    network.local = computation_and_networking_latency(sync, align, 0, PROGRESS_NONE, 1, NULL, iterations, skip);
+    stats_reduce(&network, 1, group_size);
+
+    // Every PE targets the same compute time, derived from the job-average network latency
+    for (factor = MIN_COMPUTE_FACTOR; factor <= max_factor; factor *= 2)
     {
-        shmem_sync_all_post();
-        computation_func(computation_arr, computation_amount);
-        shmem_sync_all_wait();
+        computation_amount = compute_amount_for_usec(factor * network.avg);
+        compute.local  = computation_latency               (computation_amount, iterations, skip);
+        stats_reduce(&compute, 1, group_size);
+
+        // Without a progress mode there is nothing to sweep: one row with the plain post/compute/wait
+        for (polls = 1; polls <= ((mode == PROGRESS_NONE) ? 1 : max_polls); polls *= 2)
+        {
+            pt->interval_ticks = (uint64_t)(factor * network.avg / polls * bench_timer.ticks_per_usec);
+            overall->local  = computation_and_networking_latency(sync, align, computation_amount, mode, polls, pt, iterations, skip);
+            overhead->local = overall->local - compute.local;
+            availability->local = 1 - (overhead->local / network.local);
+            stats_reduce(step, 3, group_size);
+
+            if (my_pe == 0)
+            {
+                char temp_str[200];
+                sprintf(temp_str, "%.2f (%gx)", factor * network.avg, factor);
+                fprintf(stream, "%*s   ", 18, temp_str);
+                if (mode == PROGRESS_NONE)
+                    sprintf(temp_str, "-");
+                else
+                    sprintf(temp_str, "%.2f (%d)", factor * network.avg / polls, polls);
+                fprintf(stream, "%*s   ", 14, temp_str);
+                sprintf(temp_str, "%.2f [%.2f-%.2f]", overall->avg, overall->range_from, overall->range_to);
+                fprintf(stream, "%*s   ", 24, temp_str);
+                sprintf(temp_str, "%.2f [%.2f-%.2f]", network.avg, network.range_from, network.range_to);
+                fprintf(stream, "%*s   ", 24, temp_str);
+                sprintf(temp_str, "%.2f [%.2f-%.2f]", compute.avg, compute.range_from, compute.range_to);
+                fprintf(stream, "%*s   ", 24, temp_str);
+                sprintf(temp_str, "%.2f [%.2f-%.2f]", overhead->avg, overhead->range_from, overhead->range_to);
+                fprintf(stream, "%*s   ", 24, temp_str);
+                sprintf(temp_str, "%.2f [%.2f-%.2f]", availability->avg, availability->range_from, availability->range_to);
+                fprintf(stream, "%*s\n", 24, temp_str);
+                if (verbosity_level >= 1)
+                {
+                    fprintf(stream, "# Across PEs (median/stddev/CV):");
+                    stats_print_spread(stream, "Overall", overall);
+                    stats_print_spread(stream, "Compute", &compute);
+                    stats_print_spread(stream, "Overhead", overhead);
+                    stats_print_spread(stream, "Availability", availability);
+                    fprintf(stream, "\n");
+                }
+            } 
+        }
     }
-    t_stop = get_microsec_time_stamp();
-    return (double)(t_stop - t_start) / (double)iterations;
+    return network.avg;
 }
 
 void print_usage(FILE *stream, const char *prog, int my_pe)
 {
     if (my_pe == 0)
     {
-        fprintf(stream, " USAGE : %s [-i ITER] [-s SKIP] [-hv] [-V VERBOSE]\n", prog);
+        fprintf(stream, " USAGE : %s [-i ITER] [-s SKIP] [-hv] [-V VERBOSE] [-T TIMER] [-n NBSYNC] [-r RADIX] [-c KERNEL] [-x FACTOR]\n", prog);
+        fprintf(stream, "        [-m PROGRESS] [-N POLLS] [-P CPU] [-S] [-a AFFINITY]\n");
         fprintf(stream, "  -i : Set number of iterations to ITER.\n");
         fprintf(stream, "       By default, the value of ITER is %d.\n", ITERATIONS_DEFAULT);
         fprintf(stream, "  -s : Set number of skip-iterations to SKIP.\n");
         fprintf(stream, "       By default, the value of SKIP is %d.\n", SKIP_DEFAULT);
+        fprintf(stream, "  -T : Select time-stamp source {rdtsc, monotonic_raw, gettimeofday}.\n");
+        fprintf(stream, "       By default, the value of TIMER is rdtsc (falls back to monotonic_raw without an invariant TSC).\n");
+        fprintf(stream, "  -n : Select non-blocking sync implementation {vendor, builtin}.\n");
+        fprintf(stream, "       vendor is shmem_sync_all_post/shmem_sync_all_wait from the SHMEM library,\n");
+        fprintf(stream, "       builtin is a split-phase dissemination sync on symmetric flags.\n");
+        fprintf(stream, "       By default, vendor is used when the library provides it, builtin otherwise.\n");
+        fprintf(stream, "  -r : Set radix of the builtin non-blocking sync to RADIX {2..%d}.\n", SYNC_RADIX_MAX);
+        fprintf(stream, "       By default, the value of RADIX is %d.\n", SYNC_RADIX_DEFAULT);
+        fprintf(stream, "  -c : Select compute kernel {spin, stream, fma, chase} to overlap with the sync.\n");
+        fprintf(stream, "       spin is a calibrated busy loop, stream a memory-bandwidth triad, fma a SIMD\n");
+        fprintf(stream, "       multiply-add loop and chase a cache-missing pointer chase.\n");
+        fprintf(stream, "       By default, the value of KERNEL is spin.\n");
+        fprintf(stream, "  -x : Sweep compute time from %.1fx to FACTORx the measured network latency, doubling each step.\n", MIN_COMPUTE_FACTOR);
+        fprintf(stream, "       By default, the value of FACTOR is %d.\n", MAX_COMPUTE_FACTOR_DEFAULT);
+        fprintf(stream, "  -m : Select what drives sync progress during the compute phase {none, poll, thread}.\n");
+        fprintf(stream, "       poll splits the compute phase into chunks and calls the progress hook between them,\n");
+        fprintf(stream, "       thread runs a pinned helper thread (SHMEM_THREAD_MULTIPLE) that calls it periodically.\n");
+        fprintf(stream, "       The hook is test() for the builtin sync and shmem_quiet() for the vendor one.\n");
+        fprintf(stream, "       By default, the value of PROGRESS is none.\n");
+        fprintf(stream, "  -N : Sweep 1, 2, 4, ... POLLS progress polls per compute phase (poll and thread modes).\n");
+        fprintf(stream, "       By default, the value of POLLS is %d.\n", MAX_POLLS_DEFAULT);
+        fprintf(stream, "  -P : Pin the progress thread to CPU.\n");
+        fprintf(stream, "       By default, every PE on a host takes its own CPU that no PE's main thread runs on,\n");
+        fprintf(stream, "       from its affinity mask or else from all online CPUs; without enough of them, set -P.\n");
+        fprintf(stream, "  -a : Pin every PE to one CPU by its rank on the host {compact, scatter, list:CPU,CPU,...}.\n");
+        fprintf(stream, "       compact fills one socket after the other, scatter round-robins over the sockets.\n");
+        fprintf(stream, "       By default, PEs stay where the launcher put them. -V 1 prints every PE's placement.\n");
+        fprintf(stream, "  -S, --scale-sweep : Repeat the measurement on PEs 0..P-1 for P = 2, 4, 8, ..., #PEs within this launch\n");
+        fprintf(stream, "       and fit network latency = a + b * log2(P). Always uses the builtin non-blocking sync.\n");
         fprintf(stream, "  -h : Print this help.\n");
         fprintf(stream, "  -v : Print version info.\n");
         fprintf(stream, "  -V : Set verbosity level {0=low, 1, 2=high}.\n");
@@ -126,17 +369,44 @@ void print_version(FILE *stream, int my_pe)
     }
 }
 
-int process_args(FILE* stream, int argc, char *argv[], int my_pe, int* iterations, int* skip, int* verbosity_level)
+int process_args(FILE* stream, int argc, char *argv[], int my_pe, int* iterations, int* skip, int* verbosity_level, timer_kind_t* timer,
+                 nb_sync_t* sync, int* radix, compute_kind_t* kernel, double* max_factor,
+                 progress_mode_t* mode, int* max_polls, int* progress_cpu, int* scale_sweep,
+                 affinity_t* affinity)
 {
     int c;
-    while ((c = getopt(argc, argv, ":vi:s:V:")) != -1)
+    static const struct option long_options[] = {
+        { "scale-sweep", no_argument, NULL, 'S' },
+        { NULL, 0, NULL, 0 }
+    };
+    while ((c = getopt_long(argc, argv, ":vSi:s:V:T:n:r:c:x:m:N:P:a:", long_options, NULL)) != -1)
     {
         switch (c)
         {
+        case 'T':
+            if (timer_parse(optarg, timer))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
         case 'v':
             print_version(stream, my_pe);
             return 1;
 
+        case 'S':
+            *scale_sweep = 1;
+            break;
+
+        case 'a':
+            if (affinity_parse(optarg, affinity))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
         case 'V':
             *verbosity_level = atoi(optarg);
             if (*verbosity_level < 0 || *verbosity_level > 2)
@@ -146,6 +416,82 @@ int process_args(FILE* stream, int argc, char *argv[], int my_pe, int* iteration
             }
             break;
 
+        case 'n':
+            if (strcmp(optarg, "vendor") == 0 && shmem_sync_all_post && shmem_sync_all_wait) {
+                sync->post = &shmem_sync_all_post;
+                sync->wait = &shmem_sync_all_wait;
+                sync->test = NULL;
+                strcpy(sync->name, "vendor");
+            }
+            else if (strcmp(optarg, "builtin") == 0) {
+                sync->post = &sync_nb_post;
+                sync->wait = &sync_nb_wait;
+                sync->test = &sync_nb_test;
+                strcpy(sync->name, "builtin dissemination");
+            }
+            else {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'r':
+            *radix = atoi(optarg);
+            if (*radix < 2 || *radix > SYNC_RADIX_MAX)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'c':
+            if (compute_parse(optarg, kernel))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'x':
+            *max_factor = atof(optarg);
+            if (*max_factor < MIN_COMPUTE_FACTOR)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'm':
+            if (strcmp(optarg, "none") == 0)
+                *mode = PROGRESS_NONE;
+            else if (strcmp(optarg, "poll") == 0)
+                *mode = PROGRESS_POLL;
+            else if (strcmp(optarg, "thread") == 0)
+                *mode = PROGRESS_THREAD;
+            else {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'N':
+            *max_polls = atoi(optarg);
+            if (*max_polls < 1)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'P':
+            *progress_cpu = atoi(optarg);
+            if (*progress_cpu < 0 || *progress_cpu >= CPU_SETSIZE)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
         case 's':
             *skip = atoi(optarg);
             if (*skip < 0)
@@ -174,33 +520,118 @@ int process_args(FILE* stream, int argc, char *argv[], int my_pe, int* iteration
 
 int main(int argc, char *argv[])
 {
-    static long pSyncRed1[_SHMEM_REDUCE_SYNC_SIZE];
-    static long pSyncRed2[_SHMEM_REDUCE_SYNC_SIZE];
-    static double pWrk1[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
-    static double pWrk2[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
-    static data_t compute, network, overall, overhead, availability;
-    volatile double *volatile computation_arr;
+    double max_factor = MAX_COMPUTE_FACTOR_DEFAULT, fit[SCALE_SIZES_MAX];
+    int sizes[SCALE_SIZES_MAX], nsizes, scale_sweep = 0;
+    compute_kind_t kernel = COMPUTE_SPIN;
+    progress_mode_t mode = PROGRESS_NONE;
+    progress_thread_t pt;
+    int max_polls = MAX_POLLS_DEFAULT, progress_cpu = -1, provided = SHMEM_THREAD_SINGLE;
     int verbosity_level = 0, iterations = ITERATIONS_DEFAULT, skip = SKIP_DEFAULT;
     int my_pe, num_pes, i;
+    int radix = SYNC_RADIX_DEFAULT;
+    timer_kind_t timer = TIMER_RDTSC;
+    affinity_t affinity;
+    placement_t *placements;
+    nb_sync_t sync = { &sync_nb_post, &sync_nb_wait, &sync_nb_test, "builtin dissemination" };
     FILE *stream = stdout;
     
-    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i += 1){
-        pSyncRed1[i] = _SHMEM_SYNC_VALUE;
-        pSyncRed2[i] = _SHMEM_SYNC_VALUE;
+    if (shmem_sync_all_post && shmem_sync_all_wait) {
+        sync.post = &shmem_sync_all_post;
+        sync.wait = &shmem_sync_all_wait;
+        sync.test = NULL;
+        strcpy(sync.name, "vendor");
     }
-    shmem_init();
+    affinity.kind = AFFINITY_NONE;
+    // The thread level has to be requested in shmem_init_thread, before the arguments are parsed
+    for (i = 1; i < argc - 1; i++)
+        if (strcmp(argv[i], "-m") == 0 && strcmp(argv[i + 1], "thread") == 0)
+            mode = PROGRESS_THREAD;
+    for (i = 1; i < argc; i++)
+        if (strcmp(argv[i], "-mthread") == 0)
+            mode = PROGRESS_THREAD;
+    if (mode == PROGRESS_THREAD)
+        shmem_init_thread(SHMEM_THREAD_MULTIPLE, &provided);
+    else
+        shmem_init();
     my_pe = shmem_my_pe();
     num_pes = shmem_n_pes();
 
-    if (process_args(stream, argc, argv, my_pe, &iterations, &skip, &verbosity_level) != 0)
+    if (process_args(stream, argc, argv, my_pe, &iterations, &skip, &verbosity_level, &timer, &sync, &radix, &kernel, &max_factor,
+                     &mode, &max_polls, &progress_cpu, &scale_sweep, &affinity) != 0)
     {
         shmem_finalize();
         return 0;
     }        
+    if (mode == PROGRESS_THREAD && provided < SHMEM_THREAD_MULTIPLE)
+    {
+        if (my_pe == 0)
+            fprintf(stream, "SHMEM_THREAD_MULTIPLE is not supported by this library!\n");
+        shmem_finalize();
+        return 1;
+    }
+    if (timer_init(timer) && my_pe == 0)
+        fprintf(stream, "# Warning: no invariant cycle counter, falling back to %s timer.\n", bench_timer.name);
+    // The vendor sync only knows the whole job, the builtin one follows the sweep's group
+    if (scale_sweep && !sync.test)
+    {
+        sync.post = &sync_nb_post;
+        sync.wait = &sync_nb_wait;
+        sync.test = &sync_nb_test;
+        strcpy(sync.name, "builtin dissemination");
+    }
+
+    placements = (placement_t *)malloc(num_pes * sizeof(placement_t));
+    if (!placements || affinity_init(&affinity, placements))
+    {
+        fprintf(stream, "[%2d/%2d]: Pinning failed!\n", my_pe, num_pes);
+        shmem_finalize();
+        return 1;
+    }
+    affinity_print_info(stream, my_pe, num_pes, &affinity, placements, verbosity_level);
+    if (mode == PROGRESS_THREAD && progress_cpu < 0)
+        progress_cpu = progress_thread_default_cpu(placements, my_pe, num_pes);
+    free(placements);
+
+    if (sync_algorithms_init(radix) || compute_init(kernel) || stats_init())
+    {
+        fprintf(stream, "Allocation Failed!\n");
+        shmem_finalize();
+        return 1;
+    }
+
+    if (mode == PROGRESS_THREAD)
+    {
+        pt.started = 0;
+        if (progress_cpu < 0)
+            fprintf(stream, "[%2d/%2d]: No CPU left for the progress thread on this host, pin it with -P!\n", my_pe, num_pes);
+        else if (progress_thread_start(&pt, &sync, progress_cpu))
+        {
+            fprintf(stream, "[%2d/%2d]: Progress thread creation failed!\n", my_pe, num_pes);
+            progress_cpu = -1;
+        }
+        else
+            pt.started = 1;
+        // Every PE has to leave together, the others would wait in the first sync otherwise
+        if (any_pe_failed(progress_cpu < 0))
+        {
+            if (pt.started)
+                progress_thread_stop(&pt);
+            shmem_finalize();
+            return 1;
+        }
+    }
 
+    timer_print_info(stream, my_pe);
     if (my_pe == 0)
     {
-        fprintf(stream, "%*s   ", 18, "Computation-Amount");
+        fprintf(stream, "# Non-blocking sync: %s", sync.name);
+        if (sync.test)
+            fprintf(stream, " (radix %d)", radix);
+        fprintf(stream, "\n");
+        fprintf(stream, "# Compute kernel: %s (%.3f ns per unit on PE 0)\n", bench_compute.name, bench_compute.ns_per_unit);
+        fprintf(stream, "# Progress: %s\n", (mode == PROGRESS_POLL) ? "poll" : (mode == PROGRESS_THREAD) ? "thread" : "none");
+        fprintf(stream, "%*s   ", 18, "Compute-Target");
+        fprintf(stream, "%*s   ", 14, "Poll-Interval");
         fprintf(stream, "%*s   ", 24, "Overall-Latency");
         fprintf(stream, "%*s   ", 24, "Network-latency");
         fprintf(stream, "%*s   ", 24, "Computation-Latency");
@@ -208,59 +639,28 @@ int main(int argc, char *argv[])
         fprintf(stream, "%*s\n", 24, "Availability");
     }
 
-    computation_arr = (double *) malloc(COMPUTE_BUFFER_SIZE * sizeof(double));
-    if(computation_arr == NULL){
-        fprintf(stream, "Allocation Failed!\n");
-        shmem_finalize();
-    }
-    
-    network.local = computation_and_networking_latency(NULL, 0, iterations, skip);
-    shmem_double_min_to_all(&(network.range_from)   , &(network.local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-    shmem_double_max_to_all(&(network.range_to)     , &(network.local), 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-    shmem_double_sum_to_all(&(network.avg)          , &(network.local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-    network.avg /= num_pes;
-
-    for (i = 1 ;i < (COMPUTE_BUFFER_SIZE+1) ;i*=2)
+    if (scale_sweep)
     {
-        compute.local  = computation_latency               (computation_arr, i, iterations, skip);
-        overall.local  = computation_and_networking_latency(computation_arr, i, iterations, skip);
-        overhead.local = overall.local - compute.local;
-        availability.local = 1 - (overhead.local / network.local);
-
-        shmem_barrier_all();
-        shmem_double_min_to_all(&(compute.range_from)   , &(compute.local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-        shmem_double_max_to_all(&(compute.range_to)     , &(compute.local), 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-        shmem_double_sum_to_all(&(compute.avg)          , &(compute.local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-        compute.avg /= num_pes;
-        shmem_double_min_to_all(&(overall.range_from)   , &(overall.local), 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-        shmem_double_max_to_all(&(overall.range_to)     , &(overall.local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-        shmem_double_sum_to_all(&(overall.avg)          , &(overall.local), 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-        overall.avg /= num_pes;
-        shmem_double_min_to_all(&(overhead.range_from)   , &(overhead.local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-        shmem_double_max_to_all(&(overhead.range_to)     , &(overhead.local), 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-        shmem_double_sum_to_all(&(overhead.avg)          , &(overhead.local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-        overhead.avg /= num_pes;
-        shmem_double_min_to_all(&(availability.range_from)   , &(availability.local), 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-        shmem_double_max_to_all(&(availability.range_to)     , &(availability.local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-        shmem_double_sum_to_all(&(availability.avg)          , &(availability.local), 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-        availability.avg /= num_pes;
-
-        if (my_pe == 0)
+        nsizes = scale_sizes(num_pes, sizes);
+        for (i = 0; i < nsizes; i++)
         {
-            char temp_str[200];
-            fprintf(stream, "%18d   ", i);
-            sprintf(temp_str, "%.2f [%.2f-%.2f]", overall.avg, overall.range_from, overall.range_to);
-            fprintf(stream, "%*s   ", 24, temp_str);
-            sprintf(temp_str, "%.2f [%.2f-%.2f]", network.avg, network.range_from, network.range_to);
-            fprintf(stream, "%*s   ", 24, temp_str);
-            sprintf(temp_str, "%.2f [%.2f-%.2f]", compute.avg, compute.range_from, compute.range_to);
-            fprintf(stream, "%*s   ", 24, temp_str);
-            sprintf(temp_str, "%.2f [%.2f-%.2f]", overhead.avg, overhead.range_from, overhead.range_to);
-            fprintf(stream, "%*s   ", 24, temp_str);
-            sprintf(temp_str, "%.2f [%.2f-%.2f]", availability.avg, availability.range_from, availability.range_to);
-            fprintf(stream, "%*s\n", 24, temp_str);
-        } 
+            scale_set_group(sizes[i]);
+            if (my_pe < sizes[i])
+            {
+                if (my_pe == 0)
+                    fprintf(stream, "# PEs 0..%d\n", sizes[i] - 1);
+                fit[i] = run_overlap_table(stream, my_pe, sizes[i], &scale_align, &sync, mode, max_polls, &pt, max_factor,
+                                           iterations, skip, verbosity_level);
+            }
+            shmem_barrier_all();
+        }
+        if (my_pe == 0)
+            scale_print_fit(stream, "Network-latency", nsizes, sizes, fit);
+        scale_set_group(num_pes);
     }
+    else
+        run_overlap_table(stream, my_pe, num_pes, &shmem_barrier_all, &sync, mode, max_polls, &pt, max_factor, iterations, skip, verbosity_level);
+
     if (my_pe == 0) {
         char temp_str[200];
         //Benchmark signature
@@ -275,7 +675,11 @@ int main(int argc, char *argv[])
         fprintf(stream, "%*d\n", 6, num_pes);
     }
     
-    free((void *)computation_arr);
+    if (mode == PROGRESS_THREAD)
+        progress_thread_stop(&pt);
+    stats_finalize();
+    compute_finalize();
+    sync_algorithms_finalize();
     shmem_finalize();
     return 0;
 }
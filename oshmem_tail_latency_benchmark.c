@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <sys/time.h>
 #include <stdint.h>
@@ -8,90 +9,298 @@
 #include <math.h>
 #include <string.h>
 #include <limits.h>
+#include <getopt.h>
+#include "oshmem_bench_timer.h"
+#include "oshmem_bench_sync_algorithms.h"
+#include "oshmem_bench_histogram.h"
+#include "oshmem_bench_clock.h"
+#include "oshmem_bench_teams.h"
+#include "oshmem_bench_scale.h"
+#include "oshmem_bench_noise.h"
+#include "oshmem_bench_fwq.h"
+#include "oshmem_bench_affinity.h"
+#include "oshmem_bench_adaptive.h"
+#include "oshmem_bench_stats.h"
+#include "oshmem_bench_collectives.h"
+#include "oshmem_bench_p2p.h"
+#include "oshmem_bench_atomics.h"
+#include "oshmem_bench_cache.h"
+#include "oshmem_bench_arrival.h"
+#include "oshmem_bench_perf.h"
+#include "oshmem_bench_trace.h"
+#include "oshmem_bench_dump.h"
+#include "oshmem_bench_series.h"
 
 #define BENCHMARK "OpenSHMEM Sync Tail-Latency Test"
 #define SKIP_DEFAULT                    (200)
 #define ITERATIONS_DEFAULT              (100000)
 #define MAX_PERCENTAGE_ARRAY_SIZE       (50)
+#define GLOBAL_PERCENTAGES_SIZE         (4)
+#define SKEW_CHUNK_SIZE                 (4096)
+#define SKEW_SYNC_ROUNDS                (20)
+#define FWQ_QUANTA_DEFAULT              (10000)
+#define TEAM_ROW_SIZE                   (2 + 3 * (MAX_PERCENTAGE_ARRAY_SIZE + 1))
+#define STRAGGLER_ROWS_DEFAULT          (10)
+#define SERIES_WORST_WINDOWS            (5)
+
+static const double global_percentages[GLOBAL_PERCENTAGES_SIZE] = { 0.5, 0.99, 0.999, 0.9999 };
 
 typedef struct benchmark_func{
     void (*func_ptr)(void);
     char func_name[30];
 }benchmark_func_t;
 
-typedef struct data{
-    double local, avg;
-    double range_from, range_to;
-}data_t;
+// Per-iteration enter/exit time stamps are buffered in chunks of local time.
+// At the end of each chunk the clock offsets are re-estimated, the chunk is mapped onto PE 0's
+// timeline by interpolating between the previous and the new estimate, and first/last enter/exit
+// of every iteration are found with one min and one max reduction over the whole chunk.
+// With straggler attribution, a min reduction over the PEs whose enter stamp is the last one names the
+// last-arriving PE of every iteration; PE 0 keeps it with the iteration's completion time and arrival skew.
+typedef struct skew{
+    double *stamps, *first, *last;
+    double *pWrk1, *pWrk2;
+    long *pSync1, *pSync2;
+    int count;
+    histogram_t arrival, departure, completion;
+    int attribute;
+    int *candidates, *last_pes;         // symmetric [SKEW_CHUNK_SIZE]
+    int *pWrk3;
+    long *pSync3;
+    int *straggler;                     // PE 0: last-arriving PE of every recorded iteration
+    double *straggler_completion, *straggler_skew;
+    long recorded, allocated;
+    long dropped;                       // PE 0: iterations left unattributed because the arrays couldn't grow
+}skew_t;
+
+static char skew_hostname[HOSTNAME_SIZE];
 
 void empty_func(){}
 
-void swap(double *xp, double *yp)
+#if HAVE_SHMEM_TEAMS
+static shmem_team_t bench_team;
+
+void team_sync_func(void)
 {
-    double temp = *xp;
-    *xp = *yp;
-    *yp = temp;
+    shmem_team_sync(bench_team);
 }
- 
-void bubble_sort(double arr[], int n)
+#endif
+
+int skew_init(skew_t *skew, int significant_digits, int attribute)
 {
-   int i, j;
-   for (i = 0; i < n-1; i++)     
-       // Last i elements are already in place  
-       for (j = 0; j < n-i-1; j++)
-           if (arr[j] > arr[j+1])
-              swap(&arr[j], &arr[j+1]);
+    size_t wrk_size = SKEW_CHUNK_SIZE + 1, int_wrk_size = SKEW_CHUNK_SIZE / 2 + 1;
+    int i;
+    if (wrk_size < _SHMEM_REDUCE_MIN_WRKDATA_SIZE)
+        wrk_size = _SHMEM_REDUCE_MIN_WRKDATA_SIZE;
+    if (int_wrk_size < _SHMEM_REDUCE_MIN_WRKDATA_SIZE)
+        int_wrk_size = _SHMEM_REDUCE_MIN_WRKDATA_SIZE;
+    memset(skew, 0, sizeof(*skew));
+    skew->stamps = (double *)shmem_malloc(2 * SKEW_CHUNK_SIZE * sizeof(double));
+    skew->first  = (double *)shmem_malloc(2 * SKEW_CHUNK_SIZE * sizeof(double));
+    skew->last   = (double *)shmem_malloc(2 * SKEW_CHUNK_SIZE * sizeof(double));
+    skew->pWrk1  = (double *)shmem_malloc(wrk_size * sizeof(double));
+    skew->pWrk2  = (double *)shmem_malloc(wrk_size * sizeof(double));
+    skew->pSync1 = (long *)shmem_malloc(_SHMEM_REDUCE_SYNC_SIZE * sizeof(long));
+    skew->pSync2 = (long *)shmem_malloc(_SHMEM_REDUCE_SYNC_SIZE * sizeof(long));
+    if (!skew->stamps || !skew->first || !skew->last || !skew->pWrk1 || !skew->pWrk2 || !skew->pSync1 || !skew->pSync2)
+        return -1;
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i += 1){
+        skew->pSync1[i] = _SHMEM_SYNC_VALUE;
+        skew->pSync2[i] = _SHMEM_SYNC_VALUE;
+    }
+    if (histogram_init(&skew->arrival, HISTOGRAM_HIGHEST_NSEC, significant_digits) ||
+        histogram_init(&skew->departure, HISTOGRAM_HIGHEST_NSEC, significant_digits) ||
+        histogram_init(&skew->completion, HISTOGRAM_HIGHEST_NSEC, significant_digits))
+        return -1;
+    skew->attribute = attribute;
+    if (attribute)
+    {
+        skew->candidates = (int *)shmem_malloc(SKEW_CHUNK_SIZE * sizeof(int));
+        skew->last_pes   = (int *)shmem_malloc(SKEW_CHUNK_SIZE * sizeof(int));
+        skew->pWrk3      = (int *)shmem_malloc(int_wrk_size * sizeof(int));
+        skew->pSync3     = (long *)shmem_malloc(_SHMEM_REDUCE_SYNC_SIZE * sizeof(long));
+        if (!skew->candidates || !skew->last_pes || !skew->pWrk3 || !skew->pSync3)
+            return -1;
+        for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i += 1)
+            skew->pSync3[i] = _SHMEM_SYNC_VALUE;
+        gethostname(skew_hostname, sizeof(skew_hostname));
+        skew_hostname[HOSTNAME_SIZE - 1] = '\0';
+    }
+    clock_sync_init(CLOCK_SYNC_ROUNDS_DEFAULT);
+    return 0;
 }
 
-int64_t get_microsec_time_stamp()
+void skew_destroy(skew_t *skew)
 {
-    int64_t retval;
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL))
+    histogram_destroy(&skew->completion);
+    histogram_destroy(&skew->departure);
+    histogram_destroy(&skew->arrival);
+    free(skew->straggler_skew);
+    free(skew->straggler_completion);
+    free(skew->straggler);
+    shmem_barrier_all();
+    if (skew->attribute) {
+        shmem_free(skew->pSync3);
+        shmem_free(skew->pWrk3);
+        shmem_free(skew->last_pes);
+        shmem_free(skew->candidates);
+    }
+    shmem_free(skew->pSync2);
+    shmem_free(skew->pSync1);
+    shmem_free(skew->pWrk2);
+    shmem_free(skew->pWrk1);
+    shmem_free(skew->last);
+    shmem_free(skew->first);
+    shmem_free(skew->stamps);
+}
+
+// PE 0 keeps the last-arriving PE, completion time and arrival skew of every iteration of the chunk.
+void skew_attribute(skew_t *skew, int my_pe, int num_pes)
+{
+    int *straggler;
+    double *completion, *arrival;
+    long allocated;
+    int i;
+    for (i = 0; i < skew->count; i++)
+        skew->candidates[i] = (skew->stamps[2 * i] == skew->last[2 * i]) ? my_pe : num_pes;
+    shmem_int_min_to_all(skew->last_pes, skew->candidates, skew->count, 0, 0, num_pes, skew->pWrk3, skew->pSync3);
+    if (my_pe != 0)
+        return;
+    if (skew->recorded + skew->count > skew->allocated)
     {
-        perror("gettimeofday");
-        abort();
+        allocated = 2 * skew->allocated + SKEW_CHUNK_SIZE;
+        straggler = (int *)realloc(skew->straggler, allocated * sizeof(int));
+        completion = (double *)realloc(skew->straggler_completion, allocated * sizeof(double));
+        arrival = (double *)realloc(skew->straggler_skew, allocated * sizeof(double));
+        skew->straggler = straggler ? straggler : skew->straggler;
+        skew->straggler_completion = completion ? completion : skew->straggler_completion;
+        skew->straggler_skew = arrival ? arrival : skew->straggler_skew;
+        if (!straggler || !completion || !arrival) {
+            skew->dropped += skew->count;
+            return;
+        }
+        skew->allocated = allocated;
     }
-    retval = ((int64_t)tv.tv_sec) * 1000000 + tv.tv_usec;
-    return retval;
+    for (i = 0; i < skew->count; i++, skew->recorded++)
+    {
+        skew->straggler[skew->recorded] = skew->last_pes[i];
+        skew->straggler_completion[skew->recorded] = skew->last[2 * i + 1] - skew->first[2 * i];
+        skew->straggler_skew[skew->recorded] = skew->last[2 * i] - skew->first[2 * i];
+    }
+}
+
+// Collective: every PE calls it after the same number of skew_record() calls.
+void skew_flush(skew_t *skew)
+{
+    int num_pes = shmem_n_pes(), i;
+    if (skew->count == 0)
+        return;
+    clock_sync_update(SKEW_SYNC_ROUNDS);
+    for (i = 0; i < 2 * skew->count; i++)
+        skew->stamps[i] = clock_global_ns(skew->stamps[i]);
+
+    shmem_double_min_to_all(skew->first, skew->stamps, 2 * skew->count, 0, 0, num_pes, skew->pWrk1, skew->pSync1);
+    shmem_double_max_to_all(skew->last , skew->stamps, 2 * skew->count, 0, 0, num_pes, skew->pWrk2, skew->pSync2);
+    for (i = 0; i < skew->count; i++)
+    {
+        histogram_record(&skew->arrival   , (int64_t)(skew->last[2 * i]     - skew->first[2 * i]));
+        histogram_record(&skew->departure , (int64_t)(skew->last[2 * i + 1] - skew->first[2 * i + 1]));
+        histogram_record(&skew->completion, (int64_t)(skew->last[2 * i + 1] - skew->first[2 * i]));
+    }
+    if (skew->attribute)
+        skew_attribute(skew, shmem_my_pe(), num_pes);
+    skew->count = 0;
+}
+
+void skew_record(skew_t *skew, uint64_t t_start, uint64_t t_stop)
+{
+    skew->stamps[2 * skew->count]     = clock_ticks_to_local_ns(t_start);
+    skew->stamps[2 * skew->count + 1] = clock_ticks_to_local_ns(t_stop);
+    if (++skew->count == SKEW_CHUNK_SIZE)
+        skew_flush(skew);
 }
 
-void run_local_latencies_benchmark( void (*func)(void), int iterations, int skip, double* local_latencies, double *local_min, double *local_max, double* local_avg)
+// pre_func lines the PEs up before every timed call (shmem_barrier_all unless only a team is measured or an
+// arrival pattern is selected). Injected noise is part of the timed region, like OS noise hitting a
+// bulk-synchronous step right before its sync.
+void run_local_latencies_benchmark( void (*func)(void), void (*pre_func)(void), int iterations, int skip, histogram_t* local_latencies, double *local_min, double *local_max, double* local_avg,
+                                    skew_t* skew, noise_t* noise, arrival_t* arrival, perf_t* perf, trace_t* trace,
+                                    dump_t* dump, series_t* series)
 {
     double curr_latency;
-    int i;
+    int64_t curr_latency_ns, injected_ns = 0;
+    int i, my_pe = shmem_my_pe();
     *local_avg = 0;
     *local_min = __DBL_MAX__;
     *local_max = 0;
     for (i=0 ; i < (iterations + skip); i++)
     {
-        int64_t t_start, t_stop;
-        shmem_barrier_all();
-        t_start = get_microsec_time_stamp();
+        uint64_t t_pre = 0, t_start, t_stop;
+        if (trace)
+            t_pre = timer_read();
+        pre_func();
+        if (perf)
+            perf_read(perf, perf->before);
+        t_start = timer_read();
+        if (noise)
+            injected_ns = noise_inject(noise, my_pe);
         func();
-        t_stop = get_microsec_time_stamp();
-        curr_latency = t_stop - t_start;
+        t_stop = timer_read();
+        if (perf)
+            perf_read(perf, perf->after);
+        curr_latency_ns = (int64_t)timer_ticks_to_nsec(t_stop - t_start);
+        curr_latency = curr_latency_ns / 1000.0;
+        if (trace)
+            trace_record(trace, t_pre, t_start, t_stop, injected_ns);
         
         if (i >= skip) {
-            local_latencies[i - skip] = curr_latency;
+            histogram_record(local_latencies, curr_latency_ns);
             *local_min = (*local_min < curr_latency) ? *local_min : curr_latency;
             *local_max = (*local_max > curr_latency) ? *local_max : curr_latency;
             *local_avg += curr_latency;
+            if (skew)
+                skew_record(skew, t_start, t_stop);
+            if (noise)
+                noise_record(noise, injected_ns);
+            if (arrival)
+                arrival_record(arrival, curr_latency_ns);
+            if (perf)
+                perf_record(perf, curr_latency_ns);
+            if (dump)
+                dump_record(dump, curr_latency_ns);
+            if (series)
+                series_record(series, t_start, curr_latency_ns);
         }
     }
+    if (skew)
+        skew_flush(skew);
+    if (arrival)
+        arrival_flush(arrival);
     *local_avg /= (double)iterations;
 }
 
-double percentile_latency(const double* arr, int arr_size, double percentage) 
+double percentile_latency(const histogram_t* local_latencies, double percentage) 
 {
-    int index = (double)arr_size * percentage;
-    if (index >= arr_size)
-        index = arr_size - 1;
-    return arr[index];
+    return histogram_value_at_percentile(local_latencies, percentage) / 1000.0;
+}
+
+// Collective over all PEs: nonzero if failed is nonzero on any PE, so that all of them can bail out together
+int any_pe_failed(int failed)
+{
+    static long pSync[_SHMEM_REDUCE_SYNC_SIZE];
+    static int pWrk[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static int local, global;
+    int i;
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i++)
+        pSync[i] = _SHMEM_SYNC_VALUE;
+    local = failed;
+    shmem_barrier_all();
+    shmem_int_max_to_all(&global, &local, 1, 0, 0, shmem_n_pes(), pWrk, pSync);
+    return global;
 }
 
 void print_results( FILE *stream, int my_pe, int iterations, int skip, int num_pes, double global_min, double global_max, 
-                    data_t* avg, data_t* tails, double* percentages, int percentages_size, char* func_name)
+                    data_t* avg, data_t* tails, double* percentages, int percentages_size, char* func_name,
+                    const histogram_t* global_latencies)
 {
     if (my_pe == 0) {
         int i;
@@ -99,6 +308,7 @@ void print_results( FILE *stream, int my_pe, int iterations, int skip, int num_p
 
         //Benchmark signature
         fprintf(stream, "# %s\n", BENCHMARK);
+        timer_print_info(stream, my_pe);
 
         //Results header
         fprintf(stream, "%*s", 22, "Noised-Avg");
@@ -117,23 +327,1264 @@ void print_results( FILE *stream, int my_pe, int iterations, int skip, int num_p
         fprintf(stream, "%*s", 18, temp_str);
         for(i = 0; i < percentages_size; i++)
         {
-            sprintf(temp_str, "%.2f [%.2f-%.2f]", tails[i].avg, tails[i].range_from, tails[i].range_to);
-            fprintf(stream, "%*s", 24, temp_str);
+            sprintf(temp_str, "%.2f [%.2f-%.2f]", tails[i].avg, tails[i].range_from, tails[i].range_to);
+            fprintf(stream, "%*s", 24, temp_str);
+        }
+        fprintf(stream, "%*d", 7, iterations);
+        fprintf(stream, "%*d", 5, skip);
+        fprintf(stream, "%*d", 6, num_pes);
+        fprintf(stream, "%*s\n", 20, func_name);
+
+        //Spread of the per-PE values
+        fprintf(stream, "# Across PEs (median/stddev/CV):");
+        stats_print_spread(stream, "Noised-Avg", avg);
+        for(i = 0; i < percentages_size; i++)
+        {
+            sprintf(temp_str, "%.1f%%", percentages[i] * 100.0);
+            stats_print_spread(stream, temp_str, &tails[i]);
+        }
+        fprintf(stream, "\n");
+
+        //Job-wide percentiles, taken from the merged distribution instead of averaging per-PE percentiles
+        if (global_latencies) {
+            fprintf(stream, "%*s", 22, "Job-wide");
+            sprintf(temp_str, "[%.2f-%.2f]", global_latencies->min / 1000.0, global_latencies->max / 1000.0);
+            fprintf(stream, "%*s", 18, temp_str);
+            for(i = 0; i < percentages_size; i++)
+                fprintf(stream, "%*.2f", 24, percentile_latency(global_latencies, percentages[i]));
+            fprintf(stream, "\n# Job-wide percentiles of %ld samples (%d significant digits):",
+                    global_latencies->total_count, global_latencies->significant_digits);
+            for(i = 0; i < GLOBAL_PERCENTAGES_SIZE; i++)
+                fprintf(stream, "  p%g %.2f", global_percentages[i] * 100.0, percentile_latency(global_latencies, global_percentages[i]));
+            fprintf(stream, "\n");
+        }
+    }
+}
+
+void print_skew_results(FILE *stream, int my_pe, const skew_t* skew, double* percentages, int percentages_size,
+                        double max_offset, double max_drift, double max_rtt, double max_error)
+{
+    if (my_pe == 0) {
+        const histogram_t* rows[3] = { &skew->arrival, &skew->departure, &skew->completion };
+        const char* names[3] = { "Arrival-skew", "Exit-skew", "Completion" };
+        int i, j;
+
+        fprintf(stream, "# Cross-PE skew on PE 0's timeline (max |offset| %.2f us, max drift %.2f ppm, max min-RTT %.2f us,\n"
+                "# max offset-model error %.2f us at the end)\n",
+                max_offset / 1000.0, max_drift * 1e6, max_rtt / 1000.0, max_error / 1000.0);
+        fprintf(stream, "%*s", 22, "");
+        fprintf(stream, "%*s", 18, "Max");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 23, percentages[i] * 100.0);
+        fprintf(stream, "\n");
+        for(j = 0; j < 3; j++)
+        {
+            fprintf(stream, "%*s", 22, names[j]);
+            fprintf(stream, "%*.2f", 18, rows[j]->max / 1000.0);
+            for(i = 0; i < percentages_size; i++)
+                fprintf(stream, "%*.2f", 24, percentile_latency(rows[j], percentages[i]));
+            fprintf(stream, "\n");
+        }
+    }
+}
+
+// Sorts ids by descending count, ties by ascending id.
+void rank_by_count(int *ids, int n, const long *counts)
+{
+    int i, j, id;
+    for (i = 1; i < n; i++)
+    {
+        id = ids[i];
+        for (j = i; j > 0 && (counts[ids[j - 1]] < counts[id] || (counts[ids[j - 1]] == counts[id] && ids[j - 1] > id)); j--)
+            ids[j] = ids[j - 1];
+        ids[j] = id;
+    }
+}
+
+// Blames the last-arriving PE of every iteration whose completion time falls at or above the percentage-th
+// percentile and ranks PEs and hosts by blame. x-Fair is the blame against the share a PE (or the PEs of a host)
+// would get if every PE were equally likely to arrive last; Late-by is the mean arrival skew of the blamed
+// iterations, how long the others waited for the straggler. PE 0 fetches the hostnames of the other PEs.
+void print_straggler_results(FILE *stream, int my_pe, int num_pes, const skew_t* skew, double percentage, int verbosity_level)
+{
+    if (my_pe == 0) {
+        char (*hosts)[HOSTNAME_SIZE] = malloc(num_pes * sizeof(*hosts));
+        long *blamed = calloc(2 * num_pes, sizeof(long)), *host_blamed = blamed + num_pes;
+        double *late = calloc(num_pes, sizeof(double));
+        int *ids = calloc(4 * num_pes, sizeof(int)), *host_of = ids + num_pes, *host_pes = ids + 2 * num_pes;
+        int *host_worst = ids + 3 * num_pes;
+        int64_t threshold;
+        long slow = 0, i;
+        int pe, q, nhosts = 0, rows;
+        char temp_str[200];
+
+        if (!hosts || !blamed || !late || !ids) {
+            fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+            free(ids);
+            free(late);
+            free(blamed);
+            free(hosts);
+            return;
+        }
+        threshold = histogram_lowest_value_at(&skew->completion,
+                                              histogram_counts_index(&skew->completion, histogram_value_at_percentile(&skew->completion, percentage)));
+        for (i = 0; i < skew->recorded; i++)
+        {
+            if ((int64_t)skew->straggler_completion[i] < threshold)
+                continue;
+            pe = skew->straggler[i];
+            blamed[pe]++;
+            late[pe] += skew->straggler_skew[i];
+            slow++;
+        }
+        for (pe = 0; pe < num_pes; pe++)
+        {
+            shmem_char_get(hosts[pe], skew_hostname, HOSTNAME_SIZE, pe);
+            for (q = 0; q < pe && strcmp(hosts[q], hosts[pe]) != 0; q++)
+                ;
+            host_of[pe] = (q < pe) ? host_of[q] : nhosts++;
+            if (host_pes[host_of[pe]]++ == 0 || blamed[pe] > blamed[host_worst[host_of[pe]]])
+                host_worst[host_of[pe]] = pe;
+            host_blamed[host_of[pe]] += blamed[pe];
+        }
+
+        fprintf(stream, "# Stragglers: last-arriving PE of the %ld of %ld iterations with completion >= %.2f us (%.1f%%)\n",
+                slow, skew->recorded, threshold / 1000.0, percentage * 100.0);
+        if (skew->dropped)
+            fprintf(stream, "# Warning: %ld iterations couldn't be attributed (allocation failed) and are left out of the ranking\n",
+                    skew->dropped);
+        if (slow == 0) {
+            free(ids);
+            free(late);
+            free(blamed);
+            free(hosts);
+            return;
+        }
+        fprintf(stream, "%*s%*s%*s%*s%*s%*s%*s\n", 6, "Rank", 8, "PE", 22, "Host", 10, "Blamed", 10, "Share", 10, "x-Fair", 14, "Late-by (us)");
+        for (pe = 0; pe < num_pes; pe++)
+            ids[pe] = pe;
+        rank_by_count(ids, num_pes, blamed);
+        rows = (verbosity_level > 0) ? num_pes : STRAGGLER_ROWS_DEFAULT;
+        for (i = 0; i < num_pes && i < rows && blamed[ids[i]] > 0; i++)
+        {
+            pe = ids[i];
+            fprintf(stream, "%*ld", 6, i + 1);
+            fprintf(stream, "%*d", 8, pe);
+            fprintf(stream, "%*.21s", 22, hosts[pe]);
+            fprintf(stream, "%*ld", 10, blamed[pe]);
+            sprintf(temp_str, "%.1f%%", 100.0 * blamed[pe] / slow);
+            fprintf(stream, "%*s", 10, temp_str);
+            fprintf(stream, "%*.2f", 10, (double)blamed[pe] * num_pes / slow);
+            fprintf(stream, "%*.2f\n", 14, late[pe] / blamed[pe] / 1000.0);
+        }
+
+        fprintf(stream, "%*s%*s%*s%*s%*s%*s%*s\n", 6, "Rank", 8, "#PEs", 22, "Host", 10, "Blamed", 10, "Share", 10, "x-Fair", 14, "Worst PE");
+        for (q = 0; q < nhosts; q++)
+            ids[q] = q;
+        rank_by_count(ids, nhosts, host_blamed);
+        for (i = 0; i < nhosts && i < rows && host_blamed[ids[i]] > 0; i++)
+        {
+            q = ids[i];
+            pe = host_worst[q];
+            fprintf(stream, "%*ld", 6, i + 1);
+            fprintf(stream, "%*d", 8, host_pes[q]);
+            fprintf(stream, "%*.21s", 22, hosts[pe]);
+            fprintf(stream, "%*ld", 10, host_blamed[q]);
+            sprintf(temp_str, "%.1f%%", 100.0 * host_blamed[q] / slow);
+            fprintf(stream, "%*s", 10, temp_str);
+            fprintf(stream, "%*.2f", 10, (double)host_blamed[q] * num_pes / host_pes[q] / slow);
+            fprintf(stream, "%*d\n", 14, pe);
+        }
+        free(ids);
+        free(late);
+        free(blamed);
+        free(hosts);
+    }
+}
+
+// usec as "12.34 us" below a millisecond and as "12.345 ms" from there on.
+void format_period(char *str, double usec)
+{
+    if (usec < 1000)
+        sprintf(str, "%.2f us", usec);
+    else
+        sprintf(str, "%.3f ms", usec / 1000.0);
+}
+
+void print_series_window(FILE *stream, const series_window_t* window)
+{
+    fprintf(stream, "%*.3f", 22, window->start_usec / 1000.0);
+    fprintf(stream, "%*ld", 10, window->count);
+    fprintf(stream, "%*.2f", 12, window->p50);
+    fprintf(stream, "%*.2f", 12, window->p99);
+    fprintf(stream, "%*.2f\n", 12, window->max);
+}
+
+// PE 0's windows (all of them with -V 1, else the worst by maximum), the spike periods of the job and the
+// cross-PE correlation of the window maxima.
+void print_series_results(FILE *stream, int my_pe, int num_pes, const series_t* series, double percentage, int verbosity_level)
+{
+    if (my_pe == 0) {
+        const char* names[3] = { "Window-p50", "Window-p99", "Window-max" };
+        const char* r_names[2] = { "Same-host", "Cross-host" };
+        const double* r_rows[2] = { series->r_same, series->r_cross };
+        long pairs[2] = { series->pairs_same, series->pairs_cross };
+        double *values = malloc((series->nwindows + 1) * sizeof(double));
+        long worst[SERIES_WORST_WINDOWS], w, nworst = 0, k;
+        char temp_str[200];
+        int i, j;
+
+        fprintf(stream, "# Latency windows of PE 0: %ld windows of %s (usec, starts in ms)\n", series->nwindows, series->name);
+        fprintf(stream, "%*s%*s%*s%*s\n", 22, "", 12, "Min", 12, "Median", 12, "Max");
+        for (j = 0; j < 3 && values && series->nwindows > 0; j++)
+        {
+            for (w = 0; w < series->nwindows; w++)
+                values[w] = (j == 0) ? series->windows[w].p50 : (j == 1) ? series->windows[w].p99 : series->windows[w].max;
+            qsort(values, series->nwindows, sizeof(double), &stats_compare_double);
+            fprintf(stream, "%*s", 22, names[j]);
+            fprintf(stream, "%*.2f", 12, values[0]);
+            fprintf(stream, "%*.2f", 12, series_percentile(values, series->nwindows, 0.5));
+            fprintf(stream, "%*.2f\n", 12, values[series->nwindows - 1]);
+        }
+        free(values);
+        fprintf(stream, "%*s%*s%*s%*s%*s\n", 22, "Start", 10, "Iter.", 12, "p50", 12, "p99", 12, "Max");
+        if (verbosity_level > 0) {
+            for (w = 0; w < series->nwindows; w++)
+                print_series_window(stream, &series->windows[w]);
+        }
+        else {
+            for (w = 0; w < series->nwindows; w++)
+            {
+                for (k = nworst; k > 0 && series->windows[worst[k - 1]].max < series->windows[w].max; k--)
+                    if (k < SERIES_WORST_WINDOWS)
+                        worst[k] = worst[k - 1];
+                if (k < SERIES_WORST_WINDOWS)
+                    worst[k] = w;
+                nworst += (nworst < SERIES_WORST_WINDOWS);
+            }
+            for (k = 0; k < nworst; k++)
+                print_series_window(stream, &series->windows[worst[k]]);
+        }
+
+        fprintf(stream, "# Spike periods: %.0f spikes (at or above every PE's %.1f%%) on %d PEs, lags up to ",
+                series->job_spikes, percentage * 100.0, num_pes);
+        format_period(temp_str, series->lag_bin_usec * SERIES_LAG_BINS);
+        fprintf(stream, "%s in bins of ", temp_str);
+        format_period(temp_str, series->lag_bin_usec);
+        fprintf(stream, "%s\n", temp_str);
+        if (series->nperiods == 0)
+            fprintf(stream, "# No spike period recurs at least %.0fx more often than chance\n", SERIES_PEAK_RATIO);
+        else
+            fprintf(stream, "%*s%*s%*s%*s%*s%*s\n", 6, "Rank", 16, "Period", 14, "Frequency", 10, "x-Random", 10, "Pairs", 8, "PEs");
+        for (i = 0; i < series->nperiods; i++)
+        {
+            fprintf(stream, "%*d", 6, i + 1);
+            format_period(temp_str, series->periods[i].usec);
+            fprintf(stream, "%*s", 16, temp_str);
+            sprintf(temp_str, "%.2f Hz", 1e6 / series->periods[i].usec);
+            fprintf(stream, "%*s", 14, temp_str);
+            fprintf(stream, "%*.2f", 10, series->periods[i].ratio);
+            fprintf(stream, "%*.0f", 10, series->periods[i].pairs);
+            sprintf(temp_str, "%d/%d", series->periods[i].pes, num_pes);
+            fprintf(stream, "%*s\n", 8, temp_str);
+        }
+
+        fprintf(stream, "# Cross-PE correlation of the window maxima over %ld windows\n",
+                (series->job_windows < SERIES_CORRELATION_WINDOWS) ? series->job_windows : SERIES_CORRELATION_WINDOWS);
+        fprintf(stream, "%*s%*s%*s%*s\n", 22, "", 10, "Pairs", 12, "Mean r", 18, "Range");
+        for (j = 0; j < 2; j++)
+        {
+            fprintf(stream, "%*s", 22, r_names[j]);
+            fprintf(stream, "%*ld", 10, pairs[j]);
+            if (pairs[j] == 0) {
+                fprintf(stream, "%*s\n", 12, "n/a");
+                continue;
+            }
+            fprintf(stream, "%*.3f", 12, r_rows[j][0]);
+            sprintf(temp_str, "[%.3f, %.3f]", r_rows[j][1], r_rows[j][2]);
+            fprintf(stream, "%*s\n", 18, temp_str);
+        }
+    }
+}
+
+#if HAVE_SHMEM_TEAMS
+void print_team_row(FILE *stream, const char *label, int team_pes, const data_t* avg, const data_t* tails, int percentages_size)
+{
+    int i;
+    char temp_str[200];
+
+    fprintf(stream, "%*s", 22, label);
+    fprintf(stream, "%*d", 6, team_pes);
+    sprintf(temp_str, "%.2f [%.2f-%.2f]", avg->avg, avg->range_from, avg->range_to);
+    fprintf(stream, "%*s", 24, temp_str);
+    for(i = 0; i < percentages_size; i++)
+    {
+        sprintf(temp_str, "%.2f [%.2f-%.2f]", tails[i].avg, tails[i].range_from, tails[i].range_to);
+        fprintf(stream, "%*s", 24, temp_str);
+    }
+    fprintf(stream, "\n");
+}
+
+// rows holds one TEAM_ROW_SIZE record per world PE; only the records of team leaders are valid:
+// { valid, #PEs, then avg/min/max of the noised average and of every percentile }.
+void print_team_results(FILE *stream, int my_pe, int iterations, int skip, int num_pes, const char* set_name, int concurrent,
+                        const double* rows, const data_t* avg, const data_t* tails, double* percentages, int percentages_size)
+{
+    if (my_pe == 0) {
+        static data_t team_avg, team_tails[MAX_PERCENTAGE_ARRAY_SIZE];
+        char label[30];
+        int i, pe, teams = 0;
+
+        for (pe = 0; pe < num_pes; pe++)
+            teams += (rows[pe * TEAM_ROW_SIZE] != 0);
+
+        //Benchmark signature
+        fprintf(stream, "# %s\n", BENCHMARK);
+        timer_print_info(stream, my_pe);
+        fprintf(stream, "# shmem_team_sync on %d %s teams, %s, %d iterations, %d skip\n", teams, set_name,
+                concurrent ? "all teams concurrently" : "one team at a time", iterations, skip);
+
+        //Results header
+        fprintf(stream, "%*s", 22, "Team");
+        fprintf(stream, "%*s", 6, "#PEs");
+        fprintf(stream, "%*s", 24, "Noised-Avg");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 23, percentages[i] * 100.0);
+        fprintf(stream, "\n");
+
+        //Results data, one row per team named after its leading PE, then the whole job
+        for (pe = 0; pe < num_pes; pe++)
+        {
+            const double *row = rows + pe * TEAM_ROW_SIZE;
+            if (row[0] == 0)
+                continue;
+            team_avg.avg = row[2];
+            team_avg.range_from = row[3];
+            team_avg.range_to = row[4];
+            for(i = 0; i < percentages_size; i++)
+            {
+                team_tails[i].avg = row[5 + 3 * i];
+                team_tails[i].range_from = row[6 + 3 * i];
+                team_tails[i].range_to = row[7 + 3 * i];
+            }
+            sprintf(label, "%s@%d", set_name, pe);
+            print_team_row(stream, label, (int)row[1], &team_avg, team_tails, percentages_size);
+        }
+        print_team_row(stream, "Job", num_pes, avg, tails, percentages_size);
+    }
+}
+
+// Runs the tail benchmark with shmem_team_sync on every set of the split. One team at a time means the
+// members line up with a team sync and everybody else waits; concurrently means all PEs line up with
+// shmem_barrier_all and then every team syncs at once. Returns -1 if the teams couldn't be created.
+int run_team_benchmark(FILE *stream, int my_pe, int num_pes, const team_split_t* split, int iterations, int skip,
+                       histogram_t* local_latencies, double* percentages, int percentages_size)
+{
+    static double local[MAX_PERCENTAGE_ARRAY_SIZE + 1];
+    static double team_min[MAX_PERCENTAGE_ARRAY_SIZE + 1], team_max[MAX_PERCENTAGE_ARRAY_SIZE + 1], team_sum[MAX_PERCENTAGE_ARRAY_SIZE + 1];
+    static double job_min[MAX_PERCENTAGE_ARRAY_SIZE + 1], job_max[MAX_PERCENTAGE_ARRAY_SIZE + 1], job_sum[MAX_PERCENTAGE_ARRAY_SIZE + 1];
+    static data_t avg, tails[MAX_PERCENTAGE_ARRAY_SIZE];
+    double row[TEAM_ROW_SIZE];
+    double local_min, local_max, *rows;
+    team_set_t sets[TEAM_SETS_MAX];
+    int nsets, s, leader, team_pes, i, n = percentages_size + 1;
+
+    nsets = team_sets_create(split, sets);
+    rows = (double *)shmem_malloc(num_pes * TEAM_ROW_SIZE * sizeof(double));
+    if (nsets < 0 || !rows)
+    {
+        if (nsets > 0)
+            team_sets_destroy(sets, nsets);
+        shmem_free(rows);
+        return -1;
+    }
+
+    for (s = 0; s < nsets; s++)
+    {
+        histogram_reset(local_latencies);
+        bench_team = sets[s].team;
+        team_pes = shmem_team_n_pes(bench_team);
+        memset(rows, 0, num_pes * TEAM_ROW_SIZE * sizeof(double));
+        if (split->concurrent)
+            run_local_latencies_benchmark(&team_sync_func, &shmem_barrier_all, iterations, skip, local_latencies,
+                                          &local_min, &local_max, &local[0], NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        else
+            for (leader = 0; leader < num_pes; leader++)
+            {
+                shmem_barrier_all();
+                if (sets[s].leader == leader)
+                    run_local_latencies_benchmark(&team_sync_func, &team_sync_func, iterations, skip, local_latencies,
+                                                  &local_min, &local_max, &local[0], NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+            }
+        for(i = 0; i < percentages_size; i++)
+            local[i + 1] = percentile_latency(local_latencies, percentages[i]);
+
+        // Per team: every statistic of every member in one packed reduction per operation
+        shmem_barrier_all();
+        shmem_double_min_reduce(bench_team, team_min, local, n);
+        shmem_double_max_reduce(bench_team, team_max, local, n);
+        shmem_double_sum_reduce(bench_team, team_sum, local, n);
+        if (shmem_team_my_pe(bench_team) == 0)
+        {
+            row[0] = 1;
+            row[1] = team_pes;
+            for(i = 0; i < n; i++)
+            {
+                row[2 + 3 * i] = team_sum[i] / team_pes;
+                row[3 + 3 * i] = team_min[i];
+                row[4 + 3 * i] = team_max[i];
+            }
+            shmem_double_put(rows + my_pe * TEAM_ROW_SIZE, row, 2 + 3 * n, 0);
+        }
+
+        // Whole job
+        shmem_double_min_reduce(SHMEM_TEAM_WORLD, job_min, local, n);
+        shmem_double_max_reduce(SHMEM_TEAM_WORLD, job_max, local, n);
+        shmem_double_sum_reduce(SHMEM_TEAM_WORLD, job_sum, local, n);
+        avg.avg = job_sum[0] / num_pes;
+        avg.range_from = job_min[0];
+        avg.range_to = job_max[0];
+        for(i = 0; i < percentages_size; i++)
+        {
+            tails[i].avg = job_sum[i + 1] / num_pes;
+            tails[i].range_from = job_min[i + 1];
+            tails[i].range_to = job_max[i + 1];
+        }
+        shmem_barrier_all();
+
+        print_team_results(stream, my_pe, iterations, skip, num_pes, sets[s].name, split->concurrent,
+                           rows, &avg, tails, percentages, percentages_size);
+        shmem_barrier_all();
+    }
+
+    team_sets_destroy(sets, nsets);
+    shmem_free(rows);
+    return 0;
+}
+#endif
+
+// Runs FUNC on every subset of the scaling sweep: one row per PE count, then the log2(P) fits.
+void run_scale_sweep(FILE *stream, int my_pe, int num_pes, benchmark_func_t* f, int iterations, int skip,
+                     histogram_t* local_latencies, double* percentages, int percentages_size)
+{
+    static data_t results[3 + MAX_PERCENTAGE_ARRAY_SIZE];
+    data_t *avg = &results[0], *minimum = &results[1], *maximum = &results[2], *tails = &results[3];
+    double fit[MAX_PERCENTAGE_ARRAY_SIZE + 1][SCALE_SIZES_MAX];
+    int sizes[SCALE_SIZES_MAX];
+    int nsizes = scale_sizes(num_pes, sizes), s, i, group_size;
+    char temp_str[200];
+
+    if (my_pe == 0) {
+        //Benchmark signature
+        fprintf(stream, "# %s\n", BENCHMARK);
+        timer_print_info(stream, my_pe);
+        fprintf(stream, "# Scaling sweep of %s over PEs 0..P-1, %d iterations, %d skip\n", f->func_name, iterations, skip);
+
+        //Results header
+        fprintf(stream, "%*s", 6, "#PEs");
+        fprintf(stream, "%*s", 22, "Noised-Avg");
+        fprintf(stream, "%*s", 18, "Range");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 23, percentages[i] * 100.0);
+        fprintf(stream, "\n");
+    }
+
+    for (s = 0; s < nsizes; s++)
+    {
+        group_size = sizes[s];
+        scale_set_group(group_size);
+        if (my_pe < group_size)
+        {
+            histogram_reset(local_latencies);
+            run_local_latencies_benchmark(scale_func(f->func_ptr), &scale_align, iterations, skip, local_latencies,
+                                          &(minimum->local), &(maximum->local), &(avg->local), NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+            for(i = 0; i < percentages_size; i++)
+                tails[i].local = percentile_latency(local_latencies, percentages[i]);
+            stats_reduce(results, 3 + percentages_size, group_size);
+
+            if (my_pe == 0)
+            {
+                fprintf(stream, "%*d", 6, group_size);
+                sprintf(temp_str, "%.2f [%.2f-%.2f]", avg->avg, avg->range_from, avg->range_to);
+                fprintf(stream, "%*s", 22, temp_str);
+                sprintf(temp_str, "[%.2f-%.2f]", minimum->range_from, maximum->range_to);
+                fprintf(stream, "%*s", 18, temp_str);
+                for(i = 0; i < percentages_size; i++)
+                {
+                    sprintf(temp_str, "%.2f [%.2f-%.2f]", tails[i].avg, tails[i].range_from, tails[i].range_to);
+                    fprintf(stream, "%*s", 24, temp_str);
+                    fit[i + 1][s] = tails[i].avg;
+                }
+                fprintf(stream, "\n");
+                fit[0][s] = avg->avg;
+            }
+        }
+        shmem_barrier_all();
+    }
+
+    if (my_pe == 0)
+    {
+        scale_print_fit(stream, "Noised-Avg", nsizes, sizes, fit[0]);
+        for(i = 0; i < percentages_size; i++)
+        {
+            sprintf(temp_str, "%.1f%%", percentages[i] * 100.0);
+            scale_print_fit(stream, temp_str, nsizes, sizes, fit[i + 1]);
+        }
+    }
+    scale_set_group(num_pes);
+}
+
+// Runs a data-carrying collective for every power-of-two message size up to max_bytes: one row per size.
+// With check, every size is verified once before it is timed and the PEs with wrong elements are counted.
+void run_collective_sweep(FILE *stream, int my_pe, int num_pes, const collective_t* coll, size_t max_bytes, int check,
+                          int iterations, int skip, histogram_t* local_latencies, double* percentages, int percentages_size)
+{
+    // Noised average, minimum and maximum, the percentiles, then the wrong elements of the check
+    static data_t results[4 + MAX_PERCENTAGE_ARRAY_SIZE];
+    data_t *avg = &results[0], *minimum = &results[1], *maximum = &results[2], *tails = &results[3];
+    data_t *errors = &results[3 + percentages_size];
+    size_t sizes[COLL_SIZES_MAX];
+    int nsizes = collectives_sizes(max_bytes, sizes), s, i, failed = 0;
+    char temp_str[200];
+
+    if (my_pe == 0) {
+        //Benchmark signature
+        fprintf(stream, "# %s\n", BENCHMARK);
+        timer_print_info(stream, my_pe);
+        fprintf(stream, "# Message-size sweep of %s on %d PEs, %d iterations, %d skip%s\n", coll->name, num_pes,
+                iterations, skip, check ? ", results checked" : "");
+
+        //Results header
+        fprintf(stream, "%*s", 10, "Bytes");
+        fprintf(stream, "%*s", 22, "Noised-Avg");
+        fprintf(stream, "%*s", 18, "Range");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 23, percentages[i] * 100.0);
+        if (check)
+            fprintf(stream, "%*s", 8, "Check");
+        fprintf(stream, "\n");
+    }
+
+    for (s = 0; s < nsizes; s++)
+    {
+        collectives_set_size(sizes[s]);
+        errors->local = check ? (double)collectives_check(coll) : 0;
+        histogram_reset(local_latencies);
+        run_local_latencies_benchmark(coll->func_ptr, &shmem_barrier_all, iterations, skip, local_latencies,
+                                      &(minimum->local), &(maximum->local), &(avg->local), NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        for(i = 0; i < percentages_size; i++)
+            tails[i].local = percentile_latency(local_latencies, percentages[i]);
+        stats_reduce(results, 4 + percentages_size, num_pes);
+
+        if (my_pe == 0)
+        {
+            fprintf(stream, "%*zu", 10, sizes[s]);
+            sprintf(temp_str, "%.2f [%.2f-%.2f]", avg->avg, avg->range_from, avg->range_to);
+            fprintf(stream, "%*s", 22, temp_str);
+            sprintf(temp_str, "[%.2f-%.2f]", minimum->range_from, maximum->range_to);
+            fprintf(stream, "%*s", 18, temp_str);
+            for(i = 0; i < percentages_size; i++)
+            {
+                sprintf(temp_str, "%.2f [%.2f-%.2f]", tails[i].avg, tails[i].range_from, tails[i].range_to);
+                fprintf(stream, "%*s", 24, temp_str);
+            }
+            if (check)
+                fprintf(stream, "%*s", 8, (errors->range_to > 0) ? "FAILED" : "ok");
+            fprintf(stream, "\n");
+        }
+        failed |= (errors->range_to > 0);
+    }
+    if (my_pe == 0 && failed)
+        fprintf(stream, "# %s returned wrong data, see the Check column\n", coll->name);
+}
+
+// Adaptive counterpart of run_local_latencies_benchmark(), with the same pre_func. Warm-up batches are measured but discarded;
+// recorded batches accumulate in local_latencies. After every batch the PEs agree on how to go on with one
+// max reduction of { not done, elapsed seconds, transient end }, so every PE runs the same batches.
+// ci[0..2][i].local receive this PE's final lower bound, upper bound and relative width of percentages[i].
+void run_adaptive_latencies_benchmark(void (*func)(void), void (*pre_func)(void), adaptive_t* adaptive, histogram_t* local_latencies,
+                                      double *local_min, double *local_max, double* local_avg,
+                                      double* percentages, int percentages_size, data_t (*ci)[MAX_PERCENTAGE_ARRAY_SIZE],
+                                      skew_t* skew, noise_t* noise, arrival_t* arrival, perf_t* perf, trace_t* trace,
+                                      dump_t* dump, series_t* series)
+{
+    static long pSyncRed1[_SHMEM_REDUCE_SYNC_SIZE];
+    static long pSyncRed2[_SHMEM_REDUCE_SYNC_SIZE];
+    static double pWrk1[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static double pWrk2[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
+    static double status[3], global_status[3];
+    double means[ADAPTIVE_MAX_WARMUP_BATCHES];
+    double batch_min, batch_max, batch_avg, sum = 0;
+    int64_t lower, upper;
+    uint64_t t_begin = timer_read();
+    int i, n = 0, round = 0, warmup_end = 0, num_pes = shmem_n_pes();
+
+    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i += 1){
+        pSyncRed1[i] = _SHMEM_SYNC_VALUE;
+        pSyncRed2[i] = _SHMEM_SYNC_VALUE;
+    }
+    *local_min = __DBL_MAX__;
+    *local_max = 0;
+
+    // Warm-up, for at most half of the time budget
+    do {
+        histogram_reset(local_latencies);
+        run_local_latencies_benchmark(func, pre_func, ADAPTIVE_BATCH_SIZE, 0, local_latencies,
+                                      &batch_min, &batch_max, &means[n], NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        n++;
+        status[0] = !adaptive_warmed_up(means, n, &warmup_end);
+        status[1] = timer_ticks_to_usec(timer_read() - t_begin) * 1e-6;
+        status[2] = warmup_end;
+        shmem_double_max_to_all(global_status, status, 3, 0, 0, num_pes, (round & 1) ? pWrk2 : pWrk1, (round & 1) ? pSyncRed2 : pSyncRed1);
+        round++;
+    } while (global_status[0] != 0 && global_status[1] < adaptive->budget_sec / 2);
+    adaptive->warmup_batches = n;
+    adaptive->warmup_end = (int)global_status[2];
+
+    // Recording, until the widest CI of any percentile on any PE is narrow enough
+    histogram_reset(local_latencies);
+    n = 0;
+    do {
+        if (dump)
+            dump_reserve(dump, ADAPTIVE_BATCH_SIZE);
+        run_local_latencies_benchmark(func, pre_func, ADAPTIVE_BATCH_SIZE, 0, local_latencies,
+                                      &batch_min, &batch_max, &batch_avg, skew, noise, arrival, perf, trace, dump, series);
+        n++;
+        *local_min = (*local_min < batch_min) ? *local_min : batch_min;
+        *local_max = (*local_max > batch_max) ? *local_max : batch_max;
+        sum += batch_avg;
+        status[0] = 0;
+        for (i = 0; i < percentages_size; i++)
+        {
+            ci[2][i].local = histogram_percentile_ci(local_latencies, percentages[i], ADAPTIVE_Z, &lower, &upper);
+            ci[0][i].local = lower / 1000.0;
+            ci[1][i].local = upper / 1000.0;
+            status[0] = (ci[2][i].local > status[0]) ? ci[2][i].local : status[0];
+        }
+        status[1] = timer_ticks_to_usec(timer_read() - t_begin) * 1e-6;
+        status[2] = 0;
+        shmem_double_max_to_all(global_status, status, 3, 0, 0, num_pes, (round & 1) ? pWrk2 : pWrk1, (round & 1) ? pSyncRed2 : pSyncRed1);
+        round++;
+    } while (global_status[0] > adaptive->target && global_status[1] < adaptive->budget_sec);
+    adaptive->batches = n;
+    adaptive->converged = (global_status[0] <= adaptive->target);
+    adaptive->elapsed_sec = global_status[1];
+    *local_avg = sum / n;
+}
+
+// ci as filled by run_adaptive_latencies_benchmark(), reduced over all PEs; widths are printed in percent.
+void print_adaptive_results(FILE *stream, int my_pe, const adaptive_t* adaptive, data_t (*ci)[MAX_PERCENTAGE_ARRAY_SIZE],
+                            double* percentages, int percentages_size)
+{
+    if (my_pe == 0) {
+        const char* names[3] = { "CI-lower", "CI-upper", "CI-width-%" };
+        double scale;
+        char temp_str[200];
+        int i, j;
+
+        fprintf(stream, "# Adaptive: %d warm-up batches of %d (transient ended at batch %d), %d batches recorded, %s after %.2f s\n",
+                adaptive->warmup_batches, ADAPTIVE_BATCH_SIZE, adaptive->warmup_end, adaptive->batches,
+                adaptive->converged ? "converged" : "time budget exhausted", adaptive->elapsed_sec);
+        fprintf(stream, "# 95%% order-statistic CIs of the per-PE percentiles, target width %.2f%%\n", adaptive->target * 100.0);
+        fprintf(stream, "%*s", 22, "");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 23, percentages[i] * 100.0);
+        fprintf(stream, "\n");
+        for(j = 0; j < 3; j++)
+        {
+            scale = (j == 2) ? 100.0 : 1.0;
+            fprintf(stream, "%*s", 22, names[j]);
+            for(i = 0; i < percentages_size; i++)
+            {
+                sprintf(temp_str, "%.2f [%.2f-%.2f]", ci[j][i].avg * scale, ci[j][i].range_from * scale, ci[j][i].range_to * scale);
+                fprintf(stream, "%*s", 24, temp_str);
+            }
+            fprintf(stream, "\n");
+        }
+    }
+}
+
+// Amplification is the growth of the step latency over the noise-free baseline, in units of the mean delay
+// injected per PE: 1 means the sync just passes the noise through, N on N PEs means a single delayed PE
+// holds up everybody. Percentile columns use the same mean as denominator, since sparse noise leaves most
+// percentiles of the injected delay at zero.
+void print_noise_results(FILE *stream, int my_pe, const noise_t* noise,
+                         const data_t* baseline, const data_t* baseline_tails, const data_t* avg, const data_t* tails,
+                         const data_t* injected, const data_t* injected_tails, double* percentages, int percentages_size)
+{
+    if (my_pe == 0) {
+        const data_t* rows[3][2] = { { baseline, baseline_tails }, { avg, tails }, { injected, injected_tails } };
+        const char* names[3] = { "Baseline", "Noised", "Injected" };
+        char temp_str[200];
+        int i, j;
+
+        fprintf(stream, "# Injected noise %s", noise->name);
+        if (noise->kind == NOISE_STRAGGLER)
+            fprintf(stream, " (straggler PE %d)", noise->straggler_pe);
+        fprintf(stream, "\n");
+        fprintf(stream, "%*s", 22, "");
+        fprintf(stream, "%*s", 24, "Noised-Avg");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 23, percentages[i] * 100.0);
+        fprintf(stream, "\n");
+        for(j = 0; j < 3; j++)
+        {
+            fprintf(stream, "%*s", 22, names[j]);
+            sprintf(temp_str, "%.2f [%.2f-%.2f]", rows[j][0]->avg, rows[j][0]->range_from, rows[j][0]->range_to);
+            fprintf(stream, "%*s", 24, temp_str);
+            for(i = 0; i < percentages_size; i++)
+            {
+                sprintf(temp_str, "%.2f [%.2f-%.2f]", rows[j][1][i].avg, rows[j][1][i].range_from, rows[j][1][i].range_to);
+                fprintf(stream, "%*s", 24, temp_str);
+            }
+            fprintf(stream, "\n");
+        }
+        fprintf(stream, "%*s", 22, "Amplification");
+        if (injected->avg > 0) {
+            fprintf(stream, "%*.2f", 24, (avg->avg - baseline->avg) / injected->avg);
+            for(i = 0; i < percentages_size; i++)
+                fprintf(stream, "%*.2f", 24, (tails[i].avg - baseline_tails[i].avg) / injected->avg);
+        }
+        else
+            fprintf(stream, "%*s", 24, "-");
+        fprintf(stream, "\n");
+    }
+}
+
+// Counters per call as filled by perf_summarize() and reduced over all PEs: all[e], tail[e], r[e] and
+// available[e] for every event e. An event missing on any PE is reported as n/a.
+void print_perf_results(FILE *stream, int my_pe, const perf_t* perf, const data_t* counters, double tail_percentage)
+{
+    if (my_pe == 0) {
+        const data_t *all = &counters[0], *tail = &counters[PERF_EVENTS_MAX], *r = &counters[2 * PERF_EVENTS_MAX];
+        const data_t *available = &counters[3 * PERF_EVENTS_MAX];
+        char temp_str[200];
+        int e;
+
+        fprintf(stream, "# Hardware counters per call over %ld calls, Tail: calls at or above the %.1f%% latency of their PE\n",
+                perf->count, tail_percentage * 100.0);
+        fprintf(stream, "%*s", 22, "Counter");
+        fprintf(stream, "%*s", 24, "All");
+        fprintf(stream, "%*s", 24, "Tail");
+        fprintf(stream, "%*s", 10, "Tail/All");
+        fprintf(stream, "%*s", 24, "r(latency)");
+        fprintf(stream, "\n");
+        for (e = 0; e < PERF_EVENTS_MAX; e++)
+        {
+            sprintf(temp_str, "%s%s", perf_events[e].name,
+                    (perf->slot[e] >= 0 && perf->user_only[e]) ? ":u" : (perf->slot[e] < 0 && perf_available(perf, e)) ? ":rusage" : "");
+            fprintf(stream, "%*s", 22, temp_str);
+            if (available[e].range_from == 0) {
+                fprintf(stream, "%*s\n", 24, "n/a");
+                continue;
+            }
+            sprintf(temp_str, "%.1f [%.1f-%.1f]", all[e].avg, all[e].range_from, all[e].range_to);
+            fprintf(stream, "%*s", 24, temp_str);
+            sprintf(temp_str, "%.1f [%.1f-%.1f]", tail[e].avg, tail[e].range_from, tail[e].range_to);
+            fprintf(stream, "%*s", 24, temp_str);
+            fprintf(stream, "%*.2f", 10, (all[e].avg > 0) ? tail[e].avg / all[e].avg : 0);
+            sprintf(temp_str, "%.2f [%.2f-%.2f]", r[e].avg, r[e].range_from, r[e].range_to);
+            fprintf(stream, "%*s", 24, temp_str);
+            fprintf(stream, "\n");
+        }
+    }
+}
+
+// Latency of the earliest and of the latest arriving PE of every iteration, over all iterations.
+void print_arrival_results(FILE *stream, int my_pe, const arrival_t* arrival, double* percentages, int percentages_size)
+{
+    if (my_pe == 0) {
+        const histogram_t* histograms[2] = { &arrival->earliest, &arrival->latest };
+        double sums[2] = { arrival->earliest_usec, arrival->latest_usec };
+        const char* names[2] = { "Earliest-arrival", "Latest-arrival" };
+        int i, j;
+
+        fprintf(stream, "# Arrival pattern %s", arrival->name);
+        if (arrival->kind == ARRIVAL_TRACE)
+            fprintf(stream, " (%d rows, %d columns)", arrival->rows, arrival->cols);
+        fprintf(stream, "\n");
+        fprintf(stream, "%*s", 22, "");
+        fprintf(stream, "%*s", 24, "Avg");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 23, percentages[i] * 100.0);
+        fprintf(stream, "\n");
+        for(j = 0; j < 2; j++)
+        {
+            fprintf(stream, "%*s", 22, names[j]);
+            fprintf(stream, "%*.2f", 24, arrival->recorded ? sums[j] / arrival->recorded : 0);
+            for(i = 0; i < percentages_size; i++)
+                fprintf(stream, "%*.2f", 24, percentile_latency(histograms[j], percentages[i]));
+            fprintf(stream, "\n");
+        }
+    }
+}
+
+// Warm is FUNC with only a barrier in between, cold the measured run with the cache polluted before every call.
+void print_cache_results(FILE *stream, int my_pe, const cache_pollution_t* cache, const data_t* warm, const data_t* warm_tails,
+                         const data_t* avg, const data_t* tails, double* percentages, int percentages_size)
+{
+    if (my_pe == 0) {
+        char temp_str[200];
+        int i;
+
+        fprintf(stream, "# Cache pollution %s of %.1f MiB per PE before every call\n", cache->name, cache->bytes / 1048576.0);
+        fprintf(stream, "%*s", 22, "");
+        fprintf(stream, "%*s", 24, "Noised-Avg");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 23, percentages[i] * 100.0);
+        fprintf(stream, "\n");
+        fprintf(stream, "%*s", 22, "Warm");
+        sprintf(temp_str, "%.2f [%.2f-%.2f]", warm->avg, warm->range_from, warm->range_to);
+        fprintf(stream, "%*s", 24, temp_str);
+        for(i = 0; i < percentages_size; i++)
+        {
+            sprintf(temp_str, "%.2f [%.2f-%.2f]", warm_tails[i].avg, warm_tails[i].range_from, warm_tails[i].range_to);
+            fprintf(stream, "%*s", 24, temp_str);
+        }
+        fprintf(stream, "\n");
+        fprintf(stream, "%*s", 22, "Cold");
+        sprintf(temp_str, "%.2f [%.2f-%.2f]", avg->avg, avg->range_from, avg->range_to);
+        fprintf(stream, "%*s", 24, temp_str);
+        for(i = 0; i < percentages_size; i++)
+        {
+            sprintf(temp_str, "%.2f [%.2f-%.2f]", tails[i].avg, tails[i].range_from, tails[i].range_to);
+            fprintf(stream, "%*s", 24, temp_str);
+        }
+        fprintf(stream, "\n");
+        fprintf(stream, "%*s", 22, "Cold-Warm");
+        fprintf(stream, "%*.2f", 24, avg->avg - warm->avg);
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.2f", 24, tails[i].avg - warm_tails[i].avg);
+        fprintf(stream, "\n");
+        fprintf(stream, "%*s", 22, "Cold/Warm");
+        fprintf(stream, "%*.2f", 24, (warm->avg > 0) ? avg->avg / warm->avg : 0);
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.2f", 24, (warm_tails[i].avg > 0) ? tails[i].avg / warm_tails[i].avg : 0);
+        fprintf(stream, "\n");
+    }
+}
+
+void print_fwq_row(FILE *stream, const char *label, const data_t* signature)
+{
+    char temp_str[200];
+    int j;
+    fprintf(stream, "%*s", 26, label);
+    for (j = 0; j < FWQ_SIGNATURE_SIZE; j++)
+    {
+        sprintf(temp_str, "%.2f [%.2f-%.2f]", signature[j].avg, signature[j].range_from, signature[j].range_to);
+        fprintf(stream, "%*s", 30, temp_str);
+    }
+    fprintf(stream, "\n");
+}
+
+// Runs the FWQ profiler on all PEs at the same time, then prints the noise signature of the job,
+// of every host (over its PEs) and, from verbosity level 1 on, of every PE.
+// Returns -1 on every PE if the allocation failed on any of them.
+int run_fwq_profile(FILE *stream, int my_pe, int num_pes, double quantum_usec, int quanta, int verbosity_level)
+{
+    static data_t signature[FWQ_SIGNATURE_SIZE];
+    static double local[FWQ_SIGNATURE_SIZE];
+    static char hostname[HOSTNAME_SIZE];
+    static data_t failed;
+    fwq_t fwq;
+    int i, j;
+
+    // Bail out together, the others would wait in the reductions otherwise
+    failed.local = (fwq_init(&fwq, quantum_usec, quanta) != 0);
+    stats_reduce(&failed, 1, num_pes);
+    if (failed.range_to > 0) {
+        fwq_destroy(&fwq);
+        return -1;
+    }
+    gethostname(hostname, sizeof(hostname));
+    hostname[HOSTNAME_SIZE - 1] = '\0';
+
+    shmem_barrier_all();
+    fwq_run(&fwq);
+    fwq_signature(&fwq, local);
+    for (j = 0; j < FWQ_SIGNATURE_SIZE; j++)
+        signature[j].local = local[j];
+    stats_reduce(signature, FWQ_SIGNATURE_SIZE, num_pes);
+
+    if (my_pe == 0) {
+        double (*all)[FWQ_SIGNATURE_SIZE] = malloc(num_pes * sizeof(*all));
+        char (*hosts)[HOSTNAME_SIZE] = malloc(num_pes * sizeof(*hosts));
+        int *done = calloc(num_pes, sizeof(int));
+        data_t host[FWQ_SIGNATURE_SIZE];
+        char label[HOSTNAME_SIZE + 20];
+        int pe, host_pes;
+
+        fprintf(stream, "# FWQ noise profile: %d quanta of %.2f us (%.3f ns per spin unit on PE 0), detour above +%.0f%% of the fastest quantum\n",
+                quanta, quantum_usec, bench_compute.ns_per_unit, FWQ_DETOUR_THRESHOLD * 100.0);
+        fprintf(stream, "%*s", 26, "");
+        for (j = 0; j < FWQ_SIGNATURE_SIZE; j++)
+            fprintf(stream, "%*s", 30, fwq_signature_names[j]);
+        fprintf(stream, "\n");
+        print_fwq_row(stream, "Job", signature);
+
+        if (all && hosts && done)
+        {
+            for (pe = 0; pe < num_pes; pe++) {
+                shmem_double_get(all[pe], local, FWQ_SIGNATURE_SIZE, pe);
+                shmem_char_get(hosts[pe], hostname, HOSTNAME_SIZE, pe);
+            }
+            for (pe = 0; pe < num_pes; pe++)
+            {
+                if (done[pe])
+                    continue;
+                memset(host, 0, sizeof(host));
+                for (j = 0; j < FWQ_SIGNATURE_SIZE; j++) {
+                    host[j].range_from = __DBL_MAX__;
+                    host[j].range_to = -__DBL_MAX__;
+                }
+                host_pes = 0;
+                for (i = pe; i < num_pes; i++)
+                {
+                    if (strcmp(hosts[i], hosts[pe]) != 0)
+                        continue;
+                    done[i] = 1;
+                    host_pes++;
+                    for (j = 0; j < FWQ_SIGNATURE_SIZE; j++) {
+                        host[j].avg += all[i][j];
+                        host[j].range_from = (all[i][j] < host[j].range_from) ? all[i][j] : host[j].range_from;
+                        host[j].range_to = (all[i][j] > host[j].range_to) ? all[i][j] : host[j].range_to;
+                    }
+                }
+                for (j = 0; j < FWQ_SIGNATURE_SIZE; j++)
+                    host[j].avg /= host_pes;
+                sprintf(label, "%.18s (%d PEs)", hosts[pe], host_pes);
+                print_fwq_row(stream, label, host);
+            }
+            if (verbosity_level >= 1)
+                for (pe = 0; pe < num_pes; pe++)
+                {
+                    sprintf(label, "[%4d:%4d] %.12s", pe, num_pes, hosts[pe]);
+                    fprintf(stream, "%*s", 26, label);
+                    for (j = 0; j < FWQ_SIGNATURE_SIZE; j++)
+                        fprintf(stream, "%*.2f", 30, all[pe][j]);
+                    fprintf(stream, "\n");
+                }
+        }
+        free(done);
+        free(hosts);
+        free(all);
+    }
+    shmem_barrier_all();
+    fwq_destroy(&fwq);
+    return 0;
+}
+
+static long pair_flag;
+
+// Sync latency by placement class: for every class PE 0 runs a two-PE flag-exchange sync with the first
+// PE in that class while all other PEs wait, so only the distance between the two PEs differs between rows.
+void run_placement_breakdown(FILE *stream, int my_pe, int num_pes, const placement_t* placements, int iterations, int skip,
+                             histogram_t* local_latencies, double* percentages, int percentages_size)
+{
+    static double local[MAX_PERCENTAGE_ARRAY_SIZE + 1];
+    static long epoch;
+    double remote[MAX_PERCENTAGE_ARRAY_SIZE + 1];
+    char temp_str[200];
+    int c, i, pe, partner;
+
+    if (my_pe == 0) {
+        fprintf(stream, "# Two-PE sync latency by placement class (PE 0 and the first PE of the class), %d iterations, %d skip\n",
+                iterations, skip);
+        fprintf(stream, "%*s", 22, "Class");
+        fprintf(stream, "%*s", 8, "PE");
+        fprintf(stream, "%*s", 18, "Avg");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 17, percentages[i] * 100.0);
+        fprintf(stream, "\n");
+    }
+    for (c = 0; c < PLACEMENT_CLASSES; c++)
+    {
+        for (partner = -1, pe = 1; pe < num_pes && partner < 0; pe++)
+            if (placement_class(&placements[0], &placements[pe]) == (placement_class_t)c)
+                partner = pe;
+        if (partner < 0)
+            continue;
+
+        // Every class starts from epoch 0 on both ends; all puts of the previous class have been seen
+        pair_flag = 0;
+        epoch = 0;
+        shmem_barrier_all();
+        if (my_pe == 0 || my_pe == partner)
+        {
+            int other = (my_pe == 0) ? partner : 0;
+            double sum = 0;
+            histogram_reset(local_latencies);
+            for (i = 0; i < iterations + skip; i++)
+            {
+                uint64_t t_start, t_stop;
+                int64_t latency_ns;
+                t_start = timer_read();
+                shmem_long_p(&pair_flag, ++epoch, other);
+                shmem_long_wait_until(&pair_flag, SHMEM_CMP_GE, epoch);
+                t_stop = timer_read();
+                latency_ns = (int64_t)timer_ticks_to_nsec(t_stop - t_start);
+                if (i >= skip) {
+                    histogram_record(local_latencies, latency_ns);
+                    sum += latency_ns / 1000.0;
+                }
+            }
+            local[0] = sum / iterations;
+            for(i = 0; i < percentages_size; i++)
+                local[i + 1] = percentile_latency(local_latencies, percentages[i]);
+        }
+        shmem_barrier_all();
+
+        // Both ends see the same syncs; the row is the mean of their views
+        if (my_pe == 0)
+        {
+            shmem_double_get(remote, local, percentages_size + 1, partner);
+            fprintf(stream, "%*s", 22, placement_class_names[c]);
+            fprintf(stream, "%*d", 8, partner);
+            sprintf(temp_str, "%.2f", (local[0] + remote[0]) / 2);
+            fprintf(stream, "%*s", 18, temp_str);
+            for(i = 0; i < percentages_size; i++)
+                fprintf(stream, "%*.2f", 18, (local[i + 1] + remote[i + 1]) / 2);
+            fprintf(stream, "\n");
+        }
+        shmem_barrier_all();
+    }
+}
+
+void print_p2p_row(FILE *stream, const char *label, int pes, double avg, const histogram_t* latencies,
+                   double* percentages, int percentages_size)
+{
+    int i;
+    fprintf(stream, "%*s", 30, label);
+    fprintf(stream, "%*d", 6, pes);
+    fprintf(stream, "%*.2f", 18, avg);
+    for(i = 0; i < percentages_size; i++)
+        fprintf(stream, "%*.2f", 18, percentile_latency(latencies, percentages[i]));
+    fprintf(stream, "\n");
+}
+
+// Point-to-point signaling as seen by PE 0: round trips of flag ping-pongs with the last PE, notifications
+// of all other PEs until the last acknowledgement is in, and shmem_fence/shmem_quiet alone after
+// 0, 1, 2, 4, ... P2P_OUTSTANDING_MAX outstanding non-blocking puts to the last PE.
+// Returns -1 on allocation failure.
+int run_p2p_benchmark(FILE *stream, int my_pe, int num_pes, int iterations, int skip, histogram_t* local_latencies,
+                      double* percentages, int percentages_size)
+{
+    static const struct {
+        const char *name;
+        void (*func_ptr)(void);
+        int all;
+    } exchanges[] = {
+        { "p+wait_until ping-pong" , &p2p_pingpong_p     , 0 },
+#if HAVE_SHMEM_SIGNAL
+        { "put_signal ping-pong"   , &p2p_pingpong_signal, 0 },
+#endif
+        { "p+wait_until notify-all", &p2p_notify_p       , 1 },
+#if HAVE_SHMEM_SIGNAL
+        { "put_signal notify-all"  , &p2p_notify_signal  , 1 },
+#endif
+        { NULL, NULL, 0 }
+    };
+    double local_min, local_max, local_avg = 0, sum;
+    char label[40];
+    int e, op, outstanding, i, partner = num_pes - 1;
+
+    if (p2p_init(partner))
+        return -1;
+    if (my_pe == 0) {
+        //Benchmark signature
+        fprintf(stream, "# %s\n", BENCHMARK);
+        timer_print_info(stream, my_pe);
+        fprintf(stream, "# Point-to-point signaling from PE 0, partner PE %d, %d iterations, %d skip\n", partner, iterations, skip);
+#if !HAVE_SHMEM_SIGNAL
+        fprintf(stream, "# put_signal needs OpenSHMEM 1.5, this library implements %d.%d\n", SHMEM_MAJOR_VERSION, SHMEM_MINOR_VERSION);
+#endif
+
+        //Results header
+        fprintf(stream, "%*s", 30, "Primitive");
+        fprintf(stream, "%*s", 6, "#PEs");
+        fprintf(stream, "%*s", 18, "Avg");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 17, percentages[i] * 100.0);
+        fprintf(stream, "\n");
+    }
+
+    for (e = 0; exchanges[e].name; e++)
+    {
+        p2p_reset();
+        if (exchanges[e].all || my_pe == P2P_ROOT || my_pe == partner)
+        {
+            histogram_reset(local_latencies);
+            run_local_latencies_benchmark(exchanges[e].func_ptr, &empty_func, iterations, skip, local_latencies,
+                                          &local_min, &local_max, &local_avg, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        }
+        if (my_pe == P2P_ROOT)
+            print_p2p_row(stream, exchanges[e].name, exchanges[e].all ? num_pes : 2, local_avg, local_latencies,
+                          percentages, percentages_size);
+    }
+
+    // A timed fence leaves its puts outstanding, so they are completed untimed before the next round
+    p2p_reset();
+    if (my_pe == P2P_ROOT)
+        for (op = 0; op < 2; op++)
+            for (outstanding = 0; outstanding <= P2P_OUTSTANDING_MAX; outstanding = outstanding ? 2 * outstanding : 1)
+            {
+                histogram_reset(local_latencies);
+                sum = 0;
+                for (i = 0; i < iterations + skip; i++)
+                {
+                    uint64_t t_start, t_stop;
+                    int64_t latency_ns;
+                    p2p_issue_puts(outstanding);
+                    t_start = timer_read();
+                    if (op == 0)
+                        shmem_fence();
+                    else
+                        shmem_quiet();
+                    t_stop = timer_read();
+                    if (op == 0)
+                        shmem_quiet();
+                    latency_ns = (int64_t)timer_ticks_to_nsec(t_stop - t_start);
+                    if (i >= skip) {
+                        histogram_record(local_latencies, latency_ns);
+                        sum += latency_ns / 1000.0;
+                    }
+                }
+                sprintf(label, "%s after %d puts", (op == 0) ? "shmem_fence" : "shmem_quiet", outstanding);
+                print_p2p_row(stream, label, 2, sum / iterations, local_latencies, percentages, percentages_size);
+            }
+    p2p_finalize();
+    return 0;
+}
+
+// Hot-spot contention on op: PEs 0..K-1 hammer the counters on the last PE for K = 1, 2, 4, ... #PEs - 1,
+// first all on one word, then, with words > 1, spread over that many words. Per row: per-op latency of the
+// contenders, aggregate throughput (all operations over the slowest contender's time), each contender's own
+// throughput and Jain's fairness index of those, (sum x)^2 / (K * sum x^2) = 1 / (1 + CV^2).
+// Returns -1 on allocation failure.
+int run_atomic_benchmark(FILE *stream, int my_pe, int num_pes, const atomic_op_t* op, int words, int iterations, int skip,
+                         histogram_t* local_latencies, double* percentages, int percentages_size)
+{
+    // Average, minimum, maximum, ops/s, share of successful swaps, then the percentiles
+    static data_t results[5 + MAX_PERCENTAGE_ARRAY_SIZE];
+    data_t *avg = &results[0], *minimum = &results[1], *maximum = &results[2], *rate = &results[3];
+    data_t *success = &results[4], *tails = &results[5];
+    int contenders[ATOMIC_CONTENDERS_MAX];
+    int ncontenders = atomics_contenders(num_pes, contenders), c, w, i, k, shards;
+    int cas = (op->func_ptr == &atomic_compare_swap);
+    uint64_t t_begin = 0, t_start, t_stop;
+    int64_t latency_ns;
+    double elapsed_sec;
+    long swaps = 0;
+    char temp_str[200];
+
+    if (atomics_init())
+        return -1;
+    if (my_pe == 0) {
+        //Benchmark signature
+        fprintf(stream, "# %s\n", BENCHMARK);
+        timer_print_info(stream, my_pe);
+        fprintf(stream, "# Atomic hot-spot contention: shmem_long_atomic_%s on PE %d by PEs 0..K-1, %d iterations, %d skip\n",
+                op->name, bench_atomic.target, iterations, skip);
+        fprintf(stream, "# Words: counters on separate %d-byte lines, PE k hits word k %% Words\n", ATOMIC_LINE_BYTES);
+
+        //Results header
+        fprintf(stream, "%*s", 6, "K");
+        fprintf(stream, "%*s", 7, "Words");
+        fprintf(stream, "%*s", 22, "Avg");
+        for(i = 0; i < percentages_size; i++)
+            fprintf(stream, "%*.1f%%", 23, percentages[i] * 100.0);
+        fprintf(stream, "%*s", 10, "Mops/s");
+        fprintf(stream, "%*s", 24, "PE-kops/s");
+        fprintf(stream, "%*s", 7, "Jain");
+        if (cas)
+            fprintf(stream, "%*s", 22, "Swapped-%");
+        fprintf(stream, "\n");
+    }
+
+    for (c = 0; c < ncontenders; c++)
+        for (w = 0; w < 2; w++)
+        {
+            k = contenders[c];
+            shards = w ? words : 1;
+            if (w && (words == 1 || k == 1))
+                continue;
+            atomics_reset(shards);
+            if (my_pe < k)
+            {
+                histogram_reset(local_latencies);
+                avg->local = maximum->local = 0;
+                minimum->local = __DBL_MAX__;
+                for (i = 0; i < iterations + skip; i++)
+                {
+                    if (i == skip) {
+                        t_begin = timer_read();
+                        swaps = bench_atomic.swaps;
+                    }
+                    t_start = timer_read();
+                    op->func_ptr();
+                    t_stop = timer_read();
+                    latency_ns = (int64_t)timer_ticks_to_nsec(t_stop - t_start);
+                    if (i >= skip) {
+                        histogram_record(local_latencies, latency_ns);
+                        minimum->local = (minimum->local < latency_ns / 1000.0) ? minimum->local : latency_ns / 1000.0;
+                        maximum->local = (maximum->local > latency_ns / 1000.0) ? maximum->local : latency_ns / 1000.0;
+                        avg->local += latency_ns / 1000.0;
+                    }
+                }
+                elapsed_sec = timer_ticks_to_usec(timer_read() - t_begin) / 1e6;
+                avg->local /= iterations;
+                rate->local = iterations / elapsed_sec;
+                success->local = (double)(bench_atomic.swaps - swaps) / iterations;
+                for(i = 0; i < percentages_size; i++)
+                    tails[i].local = percentile_latency(local_latencies, percentages[i]);
+                stats_reduce(results, 5 + percentages_size, k);
+
+                if (my_pe == 0)
+                {
+                    fprintf(stream, "%*d", 6, k);
+                    fprintf(stream, "%*d", 7, shards);
+                    sprintf(temp_str, "%.2f [%.2f-%.2f]", avg->avg, minimum->range_from, maximum->range_to);
+                    fprintf(stream, "%*s", 22, temp_str);
+                    for(i = 0; i < percentages_size; i++)
+                    {
+                        sprintf(temp_str, "%.2f [%.2f-%.2f]", tails[i].avg, tails[i].range_from, tails[i].range_to);
+                        fprintf(stream, "%*s", 24, temp_str);
+                    }
+                    // Every contender ran the same number of operations, so the slowest one bounds the run
+                    fprintf(stream, "%*.3f", 10, k * rate->range_from / 1e6);
+                    sprintf(temp_str, "%.1f [%.1f-%.1f]", rate->avg / 1e3, rate->range_from / 1e3, rate->range_to / 1e3);
+                    fprintf(stream, "%*s", 24, temp_str);
+                    fprintf(stream, "%*.3f", 7, 1 / (1 + rate->cv * rate->cv));
+                    if (cas)
+                    {
+                        sprintf(temp_str, "%.1f [%.1f-%.1f]", success->avg * 100, success->range_from * 100, success->range_to * 100);
+                        fprintf(stream, "%*s", 22, temp_str);
+                    }
+                    fprintf(stream, "\n");
+                }
+            }
         }
-        fprintf(stream, "%*d", 7, iterations);
-        fprintf(stream, "%*d", 5, skip);
-        fprintf(stream, "%*d", 6, num_pes);
-        fprintf(stream, "%*s\n", 20, func_name);
-    }
+    atomics_finalize();
+    return 0;
 }
 
 void print_usage(FILE *stream, const char *prog, int my_pe)
 {
     if (my_pe == 0)
     {
-        fprintf(stream, " USAGE : %s [-i ITER] [-f FUNC] [-s SKIP] [-hv] [-V VERBOSE] [-p PERCENTAGE_LIST]\n", prog);
-        fprintf(stream, "  -f : Select function {shmem_sync_all, shmem_barrier_all, sol} to benchmark.\n");
+        fprintf(stream, " USAGE : %s [-i ITER] [-f FUNC] [-r RADIX] [-s SKIP] [-hv] [-V VERBOSE] [-p PERCENTAGE_LIST] [-T TIMER] [-d DIGITS] [-g] [-k] [-t TEAMS] [-c] [-S]\n", prog);
+        fprintf(stream, "        [-n NOISE] [-w QUANTUM] [-a AFFINITY] [-b] [-A WIDTH] [-m MAX_BYTES] [-e] [-P] [-H OP] [-C POLLUTION] [-R ARRIVAL] [-K] [-J PREFIX]\n");
+        fprintf(stream, "        [-D PREFIX[:shared]] [-L PERCENTAGE] [-W WINDOW]\n");
+        fprintf(stream, "  -f : Select function {shmem_sync_all, shmem_barrier_all, empty_func,\n");
+        fprintf(stream, "       central_counter, dissemination, tree, butterfly, tournament,\n");
+        fprintf(stream, "       broadcast, sum_reduce, fcollect, alltoall} to benchmark.\n");
+        fprintf(stream, "       central_counter..tournament are user-level algorithms with shmem_sync_all semantics.\n");
+        fprintf(stream, "       broadcast..alltoall are data-carrying collectives on 64-bit elements (sum_reduce on doubles),\n");
+        fprintf(stream, "       swept over message sizes of %d, %d, ... MAX_BYTES per PE; -g, -k, -t, -n, -A and -S are ignored.\n",
+                COLL_BYTES_MIN, 2 * COLL_BYTES_MIN);
         fprintf(stream, "       By default, the value of FUNC is shmem_sync_all.\n");
+        fprintf(stream, "  -r : Set radix of the user-level sync algorithms to RADIX {2..%d}.\n", SYNC_RADIX_MAX);
+        fprintf(stream, "       By default, the value of RADIX is %d.\n", SYNC_RADIX_DEFAULT);
         fprintf(stream, "  -i : Set number of iterations to ITER.\n");
         fprintf(stream, "       By default, the value of ITER is %d.\n", ITERATIONS_DEFAULT);
         fprintf(stream, "  -s : Set number of skip-iterations to SKIP.\n");
@@ -141,6 +1592,69 @@ void print_usage(FILE *stream, const char *prog, int my_pe)
         fprintf(stream, "  -p : List tail-latency percentages to measure.\n");
         fprintf(stream, "       By default, PERCENTAGE_LIST = {0.99, 0.95}.\n");
         fprintf(stream, "       e.g., -p 0.99,0.95\n");
+        fprintf(stream, "  -T : Select time-stamp source {rdtsc, monotonic_raw, gettimeofday}.\n");
+        fprintf(stream, "       By default, the value of TIMER is rdtsc (falls back to monotonic_raw without an invariant TSC).\n");
+        fprintf(stream, "  -d : Set latency histogram precision to DIGITS significant decimal digits {1..%d}.\n", HISTOGRAM_DIGITS_MAX);
+        fprintf(stream, "       By default, the value of DIGITS is %d.\n", HISTOGRAM_DIGITS_DEFAULT);
+        fprintf(stream, "  -g : Also report job-wide percentiles of the merged latency distribution of all PEs.\n");
+        fprintf(stream, "  -k : Estimate clock offsets against PE 0 and report per-iteration arrival skew,\n");
+        fprintf(stream, "       exit skew and collective completion time (last exit - first enter).\n");
+        fprintf(stream, "  -L : Attribute slow iterations to stragglers: -L PERCENTAGE (e.g. 0.99) implies -k and blames the\n");
+        fprintf(stream, "       last-arriving PE of every iteration whose completion time is at or above that percentile, then\n");
+        fprintf(stream, "       ranks the worst %d PEs and hosts by blame (all of them with -V 1).\n", STRAGGLER_ROWS_DEFAULT);
+        fprintf(stream, "  -W : Report latency over time in windows of WINDOW {iter:N, time:USEC}: p50, p99 and max per window\n");
+        fprintf(stream, "       (the worst %d windows of PE 0, all of them with -V 1), the recurring periods of the iterations at\n", SERIES_WORST_WINDOWS);
+        fprintf(stream, "       or above the first percentage from the autocorrelation of their start times, summed over all PEs,\n");
+        fprintf(stream, "       and the correlation of the window maxima between PEs on the same and on different hosts.\n");
+        fprintf(stream, "  -t : Measure shmem_team_sync instead of FUNC on the teams of TEAMS {shared, strided:SIZE, 2d:XRANGE}:\n");
+        fprintf(stream, "       one team per node, blocks of SIZE consecutive PEs, or rows of XRANGE PEs and their columns.\n");
+        fprintf(stream, "       Results are reported per team and for the whole job. Requires OpenSHMEM 1.5.\n");
+        fprintf(stream, "  -c : With -t, sync all teams at the same moment instead of one team at a time.\n");
+        fprintf(stream, "  -n : Inject NOISE right before every timed call and report its amplification against a noise-free run:\n");
+        fprintf(stream, "       fixed:USEC[:PROB], exp:MEAN_USEC[:PROB], pareto:MIN_USEC:ALPHA[:PROB],\n");
+        fprintf(stream, "       periodic:PERIOD_USEC:DURATION_USEC or straggler:USEC[:PE] (by default the last PE).\n");
+        fprintf(stream, "       PROB is the chance per iteration and PE that a delay is drawn at all (default 1).\n");
+        fprintf(stream, "  -w : Profile OS noise first with fixed work quanta of QUANTUM_USEC on every PE: -w QUANTUM_USEC[:QUANTA].\n");
+        fprintf(stream, "       Prints the noise signature (share, frequency, duration and period of detours) of the job,\n");
+        fprintf(stream, "       of every host and, with -V 1, of every PE. By default, QUANTA is %d.\n", FWQ_QUANTA_DEFAULT);
+        fprintf(stream, "  -a : Pin every PE to one CPU by its rank on the host {compact, scatter, list:CPU,CPU,...}.\n");
+        fprintf(stream, "       compact fills one socket after the other, scatter round-robins over the sockets.\n");
+        fprintf(stream, "       By default, PEs stay where the launcher put them. -V 1 prints every PE's placement.\n");
+        fprintf(stream, "  -b : Also break two-PE sync latency down by placement class {same-L3, same-socket,\n");
+        fprintf(stream, "       cross-socket, cross-node}, taken from sysfs.\n");
+        fprintf(stream, "  -A : Adaptive iterations instead of ITER and SKIP: -A WIDTH[:BUDGET_SEC]. Runs batches of %d, detects the end\n", ADAPTIVE_BATCH_SIZE);
+        fprintf(stream, "       of warm-up from the batch means, then samples until the 95%% CI of every percentile on every PE\n");
+        fprintf(stream, "       is narrower than WIDTH (e.g. 0.05 = 5%% of the percentile) or BUDGET_SEC run out (default %.0f).\n", ADAPTIVE_BUDGET_DEFAULT);
+        fprintf(stream, "  -m : Set the largest message size of the collective sweep to MAX_BYTES {%d..%d}.\n", COLL_BYTES_MIN, COLL_MAX_BYTES_MAX);
+        fprintf(stream, "       By default, the value of MAX_BYTES is %d.\n", COLL_MAX_BYTES_DEFAULT);
+        fprintf(stream, "  -e : Check the result of the collective once per message size before timing it.\n");
+        fprintf(stream, "  -P : Measure point-to-point signaling instead of FUNC: shmem_long_p + shmem_wait_until and\n");
+        fprintf(stream, "       shmem_put_signal + shmem_signal_wait_until (OpenSHMEM 1.5) ping-pongs between PE 0 and the last PE,\n");
+        fprintf(stream, "       PE 0 notifying all other PEs, and shmem_fence/shmem_quiet after 0..%d outstanding puts.\n", P2P_OUTSTANDING_MAX);
+        fprintf(stream, "  -H : Measure atomic hot-spot contention instead of FUNC: -H OP[:WORDS], OP {fetch_add, fetch_inc, compare_swap}.\n");
+        fprintf(stream, "       PEs 0..K-1 issue OP back to back on a counter of the last PE for K = 1, 2, 4, ... #PEs-1 and report\n");
+        fprintf(stream, "       per-op latency, aggregate and per-PE throughput and fairness. With WORDS {2..%d}, every K is\n", ATOMIC_WORDS_MAX);
+        fprintf(stream, "       repeated with the counters spread over WORDS words on separate cache lines.\n");
+        fprintf(stream, "  -C : Pollute the caches between iterations, outside the timed region, and report cold against warm latency:\n");
+        fprintf(stream, "       sweep[:BYTES] writes every cache line of a BYTES buffer, random[:BYTES] chases its lines in random order.\n");
+        fprintf(stream, "       By default, BYTES is twice the largest cache of the PE's CPU (%d MiB if sysfs doesn't tell).\n",
+                CACHE_BYTES_FALLBACK / (1024 * 1024));
+        fprintf(stream, "  -R : Select how the PEs arrive at every timed call, instead of a barrier right before it:\n");
+        fprintf(stream, "       aligned, back-to-back (no barrier), gap:USEC (USEC between calls, no barrier),\n");
+        fprintf(stream, "       random:USEC (barrier, then a uniform [0, USEC) wait per PE) or trace:FILE (barrier, then the\n");
+        fprintf(stream, "       offsets in usec of FILE, one row per iteration and one column per PE, replayed cyclically).\n");
+        fprintf(stream, "       Also reports the latency seen by the earliest and the latest arriving PE. Excludes -C.\n");
+        fprintf(stream, "  -K : Read hardware counters {cycles, instructions, llc-misses, branch-misses, context-switches} around\n");
+        fprintf(stream, "       every timed call with perf_event_open and report them per call, for all calls and for the calls at\n");
+        fprintf(stream, "       or above the first percentage of the PE's latency, with their correlation to the latency.\n");
+        fprintf(stream, "  -J : Record the timeline of every iteration (pre_func, injected noise and FUNC) in memory and write it\n");
+        fprintf(stream, "       at the end as Chrome trace JSON to PREFIX.PE.json, one file per PE, on PE 0's timeline.\n");
+        fprintf(stream, "       Merge them with: jq -s '{traceEvents: map(.traceEvents) | add}' PREFIX.*.json\n");
+        fprintf(stream, "  -D : Write the raw latency of every measured iteration as binary: -D PREFIX[:shared]. One file per PE,\n");
+        fprintf(stream, "       PREFIX.PE.bin, or with :shared one file PREFIX.bin that every PE fills at its own mapped offset.\n");
+        fprintf(stream, "       tools/oshmem_bench_dump_analyze.c reads them: percentiles, per-PE and per-host tables, histogram.\n");
+        fprintf(stream, "  -S, --scale-sweep : Run FUNC on PEs 0..P-1 for P = 2, 4, 8, ..., #PEs within this launch,\n");
+        fprintf(stream, "       print one row per P and fit latency = a + b * log2(P). -g, -k and -t are ignored.\n");
         fprintf(stream, "  -h : Print this help.\n");
         fprintf(stream, "  -v : Print version info.\n");
         fprintf(stream, "  -V : Set verbosity level {0=low, 1, 2=high}.\n");
@@ -165,12 +1679,24 @@ void print_version(FILE *stream, int my_pe)
 }
 
 int process_args(   FILE* stream, int argc, char *argv[], int my_pe, int *percentages_size, double *percentages,
-                    int* iterations, int* skip, benchmark_func_t* f, int* verbosity_level)
+                    int* iterations, int* skip, benchmark_func_t* f, int* verbosity_level, timer_kind_t* timer,
+                    int* significant_digits, int* global_percentiles, int* measure_skew, double* straggler_percentage,
+                    int* radix, team_split_t* team_split, int* scale_sweep, noise_t* noise,
+                    double* fwq_quantum, int* fwq_quanta, affinity_t* affinity, int* placement_breakdown,
+                    adaptive_t* adaptive, const collective_t** collective, size_t* max_bytes, int* check,
+                    int* p2p, const atomic_op_t** atomic_op, int* atomic_words, cache_pollution_t* cache,
+                    arrival_t* arrival, int* counters, trace_t* trace, dump_t* dump, series_t* series)
 {
     int c, i;
     char temp_str[200];
     char *temp_ptr;
-    while ((c = getopt(argc, argv, ":hvi:s:f:V:p:")) != -1)
+    const sync_algorithm_t *algo;
+    const collective_t *coll;
+    static const struct option long_options[] = {
+        { "scale-sweep", no_argument, NULL, 'S' },
+        { NULL, 0, NULL, 0 }
+    };
+    while ((c = getopt_long(argc, argv, ":hvgkcSbePKi:s:f:V:p:T:d:r:t:n:w:a:A:m:H:C:R:J:D:L:W:", long_options, NULL)) != -1)
     {
         switch (c)
         {
@@ -187,6 +1713,15 @@ int process_args(   FILE* stream, int argc, char *argv[], int my_pe, int *percen
                 f->func_ptr = &empty_func;
                 strcpy(f->func_name, "empty_func");
             }
+            else if ((algo = sync_algorithm_find(optarg)) != NULL) {
+                f->func_ptr = algo->func_ptr;
+                strcpy(f->func_name, algo->name);
+            }
+            else if ((coll = collective_find(optarg)) != NULL) {
+                f->func_ptr = coll->func_ptr;
+                strcpy(f->func_name, coll->name);
+                *collective = coll;
+            }
             else {
                 print_usage(stream, argv[0], my_pe);
                 return 1;
@@ -213,6 +1748,168 @@ int process_args(   FILE* stream, int argc, char *argv[], int my_pe, int *percen
             }
             break;
 
+        case 'T':
+            if (timer_parse(optarg, timer))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'd':
+            *significant_digits = atoi(optarg);
+            if (*significant_digits < 1 || *significant_digits > HISTOGRAM_DIGITS_MAX)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'g':
+            *global_percentiles = 1;
+            break;
+
+        case 'k':
+            *measure_skew = 1;
+            break;
+
+        case 'L':
+            *straggler_percentage = atof(optarg);
+            if (*straggler_percentage <= 0 || *straggler_percentage >= 1)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            *measure_skew = 1;
+            break;
+
+        case 't':
+            if (team_split_parse(optarg, team_split))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+#if !HAVE_SHMEM_TEAMS
+            if (my_pe == 0)
+                fprintf(stream, "# Team sync benchmarks require OpenSHMEM 1.5, this library implements %d.%d.\n",
+                        SHMEM_MAJOR_VERSION, SHMEM_MINOR_VERSION);
+            return -1;
+#endif
+            break;
+
+        case 'c':
+            team_split->concurrent = 1;
+            break;
+
+        case 'S':
+            *scale_sweep = 1;
+            break;
+
+        case 'a':
+            if (affinity_parse(optarg, affinity))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'b':
+            *placement_breakdown = 1;
+            break;
+
+        case 'w':
+            if (sscanf(optarg, "%lf:%d", fwq_quantum, fwq_quanta) < 1 || *fwq_quantum <= 0 || *fwq_quanta < 1)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'm':
+            *max_bytes = (size_t)atol(optarg);
+            if (*max_bytes < COLL_BYTES_MIN || *max_bytes > COLL_MAX_BYTES_MAX)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'e':
+            *check = 1;
+            break;
+
+        case 'P':
+            *p2p = 1;
+            break;
+
+        case 'K':
+            *counters = 1;
+            break;
+
+        case 'J':
+            if (trace_parse(optarg, trace))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'W':
+            if (series_parse(optarg, series))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'D':
+            if (dump_parse(optarg, dump))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'H':
+            if (atomic_parse(optarg, atomic_op, atomic_words))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'C':
+            if (cache_parse(optarg, cache))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'R':
+            if (arrival_parse(optarg, arrival))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'A':
+            if (adaptive_parse(optarg, adaptive))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
+        case 'n':
+            if (noise_parse(optarg, noise))
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
         case 'h':
             print_usage(stream, argv[0], my_pe);
             return 1;
@@ -230,6 +1927,15 @@ int process_args(   FILE* stream, int argc, char *argv[], int my_pe, int *percen
             }
             break;
 
+        case 'r':
+            *radix = atoi(optarg);
+            if (*radix < 2 || *radix > SYNC_RADIX_MAX)
+            {
+                print_usage(stream, argv[0], my_pe);
+                return -1;
+            }
+            break;
+
         case 's':
             *skip = atoi(optarg);
             if (*skip < 0)
@@ -253,85 +1959,408 @@ int process_args(   FILE* stream, int argc, char *argv[], int my_pe, int *percen
             return -1;
         }
     }
+    if (cache->kind != CACHE_WARM && arrival->name[0])
+    {
+        print_usage(stream, argv[0], my_pe);
+        return -1;
+    }
     return 0;
 }
 
 int main(int argc, char *argv[])
 {
-    static long pSyncRed1[_SHMEM_REDUCE_SYNC_SIZE];
-    static long pSyncRed2[_SHMEM_REDUCE_SYNC_SIZE];
-    static double pWrk1[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
-    static double pWrk2[_SHMEM_REDUCE_MIN_WRKDATA_SIZE];
-    static double global_min, local_min, global_max, local_max;
-    static data_t avg;
-    static data_t tails[MAX_PERCENTAGE_ARRAY_SIZE];
+    // Noised average, minimum and maximum, then the percentiles; baseline and injected are average then percentiles
+    static data_t results[3 + MAX_PERCENTAGE_ARRAY_SIZE];
+    static data_t baseline[1 + MAX_PERCENTAGE_ARRAY_SIZE], injected[1 + MAX_PERCENTAGE_ARRAY_SIZE];
+    static data_t warm[1 + MAX_PERCENTAGE_ARRAY_SIZE];
+    static data_t ci[3][MAX_PERCENTAGE_ARRAY_SIZE];
+    static data_t clock_error[4];
+    static data_t perf_counters[4 * PERF_EVENTS_MAX];
+    double perf_local[3][PERF_EVENTS_MAX];
+    data_t *avg = &results[0], *minimum = &results[1], *maximum = &results[2], *tails = &results[3];
     double percentages[MAX_PERCENTAGE_ARRAY_SIZE] = { 0.99, 0.95, 0 };
     int percentages_size = 2;
-    double* local_latencies = NULL;
+    histogram_t local_latencies, global_latencies;
     int verbosity_level = 0, iterations = ITERATIONS_DEFAULT, skip = SKIP_DEFAULT;
+    int significant_digits = HISTOGRAM_DIGITS_DEFAULT, global_percentiles = 0, measure_skew = 0, scale_sweep = 0;
+    int radix = SYNC_RADIX_DEFAULT, fwq_quanta = FWQ_QUANTA_DEFAULT;
+    double fwq_quantum = 0, straggler_percentage = 0;
+    int placement_breakdown = 0;
+    affinity_t affinity;
+    adaptive_t adaptive;
+    const collective_t *collective = NULL;
+    size_t max_bytes = COLL_MAX_BYTES_DEFAULT;
+    int check = 0, p2p = 0;
+    const atomic_op_t *atomic_op = NULL;
+    int atomic_words = 1;
+    void (*pre_func)(void) = &shmem_barrier_all;
+    int counters = 0, tracing, dumping, windowed;
+    long record_capacity, record_skip;
+    perf_t perf;
+    trace_t trace;
+    dump_t dump;
+    dump_header_t dump_info;
+    series_t series;
+    placement_t *placements;
+    team_split_t team_split = { TEAM_SPLIT_NONE, 0, 0 };
+    skew_t skew;
+    noise_t noise;
     int my_pe, num_pes, i;
+    timer_kind_t timer = TIMER_RDTSC;
     FILE *stream = stdout;
     
     benchmark_func_t f;
+    noise.kind = NOISE_NONE;
+    affinity.kind = AFFINITY_NONE;
+    adaptive.target = 0;
+    bench_cache.kind = CACHE_WARM;
+    trace.prefix[0] = '\0';
+    dump.prefix[0] = '\0';
+    series.name[0] = '\0';
     f.func_ptr = &shmem_sync_all;
     strcpy(f.func_name, "shmem_sync_all");
     
-    for (i = 0; i < _SHMEM_REDUCE_SYNC_SIZE; i += 1){
-        pSyncRed1[i] = _SHMEM_SYNC_VALUE;
-        pSyncRed2[i] = _SHMEM_SYNC_VALUE;
-    }
-        
     shmem_init();
     my_pe = shmem_my_pe();
     num_pes = shmem_n_pes();
-    if (process_args(stream, argc, argv, my_pe, &percentages_size, percentages, &iterations, &skip, &f, &verbosity_level)){
+    if (process_args(stream, argc, argv, my_pe, &percentages_size, percentages, &iterations, &skip, &f, &verbosity_level, &timer,
+                     &significant_digits, &global_percentiles, &measure_skew, &straggler_percentage, &radix, &team_split, &scale_sweep, &noise,
+                     &fwq_quantum, &fwq_quanta, &affinity, &placement_breakdown, &adaptive,
+                     &collective, &max_bytes, &check, &p2p, &atomic_op, &atomic_words, &bench_cache,
+                     &bench_arrival, &counters, &trace, &dump, &series)){
         shmem_finalize();
         return EXIT_SUCCESS;
     }
+    if (timer_init(timer) && my_pe == 0)
+        fprintf(stream, "# Warning: no invariant cycle counter, falling back to %s timer.\n", bench_timer.name);
 
-    local_latencies = (double *)malloc(iterations * sizeof(double));
-    if (!local_latencies)
+    if (sync_algorithms_init(radix) || stats_init() ||
+        histogram_init(&local_latencies, HISTOGRAM_HIGHEST_NSEC, significant_digits) ||
+        (global_percentiles && histogram_init(&global_latencies, HISTOGRAM_HIGHEST_NSEC, significant_digits)))
     {
         fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
         shmem_finalize();
         return EXIT_FAILURE;
     }
     
-    run_local_latencies_benchmark(f.func_ptr, iterations, skip, local_latencies, &local_min, &local_max, &(avg.local));
+    placements = (placement_t *)malloc(num_pes * sizeof(placement_t));
+    if (!placements || affinity_init(&affinity, placements))
+    {
+        fprintf(stream, "[%2d/%2d]: Pinning failed!\n", my_pe, num_pes);
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
+    affinity_print_info(stream, my_pe, num_pes, &affinity, placements, verbosity_level);
 
-    // Process Data...
-    bubble_sort(local_latencies, iterations);
+    if (fwq_quantum > 0 && run_fwq_profile(stream, my_pe, num_pes, fwq_quantum, fwq_quanta, verbosity_level))
+    {
+        fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
 
-    for(i = 0; i < percentages_size; i++)
+    if (collective)
     {
-        shmem_barrier_all();
-        tails[i].local = percentile_latency(local_latencies, iterations, percentages[i]);
-        shmem_double_min_to_all(&(tails[i].range_from), &(tails[i].local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-        shmem_double_max_to_all(&(tails[i].range_to), &(tails[i].local), 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-        shmem_double_sum_to_all(&(tails[i].avg), &(tails[i].local), 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-        tails[i].avg /= num_pes;
-    }
-    shmem_double_min_to_all(&global_min, &local_min         , 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-    shmem_double_max_to_all(&global_max, &local_max         , 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-    shmem_double_min_to_all(&(avg.range_from), &(avg.local) , 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-    shmem_double_max_to_all(&(avg.range_to), &(avg.local)   , 1, 0, 0, num_pes, pWrk2, pSyncRed2);
-    shmem_double_sum_to_all(&(avg.avg), &(avg.local)        , 1, 0, 0, num_pes, pWrk1, pSyncRed1);
-    avg.avg /= num_pes;
+        if (collectives_init(collective, max_bytes))
+            fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+        else
+            run_collective_sweep(stream, my_pe, num_pes, collective, max_bytes, check, iterations, skip, &local_latencies,
+                                 percentages, percentages_size);
+        collectives_finalize();
+        goto out;
+    }
+
+    if (p2p)
+    {
+        if (num_pes < 2)
+        {
+            if (my_pe == 0)
+                fprintf(stream, "Point-to-point benchmarks need at least 2 PEs!\n");
+        }
+        else if (run_p2p_benchmark(stream, my_pe, num_pes, iterations, skip, &local_latencies, percentages, percentages_size))
+            fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+        goto out;
+    }
+
+    if (atomic_op)
+    {
+        if (run_atomic_benchmark(stream, my_pe, num_pes, atomic_op, atomic_words, iterations, skip, &local_latencies,
+                                 percentages, percentages_size))
+            fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+        goto out;
+    }
+
+    if (scale_sweep)
+    {
+        run_scale_sweep(stream, my_pe, num_pes, &f, iterations, skip, &local_latencies, percentages, percentages_size);
+        goto out;
+    }
+
+#if HAVE_SHMEM_TEAMS
+    if (team_split.kind != TEAM_SPLIT_NONE)
+    {
+        if (run_team_benchmark(stream, my_pe, num_pes, &team_split, iterations, skip, &local_latencies,
+                               percentages, percentages_size))
+            fprintf(stream, "[%2d/%2d]: Team creation failed!\n", my_pe, num_pes);
+        goto out;
+    }
+#endif
+
+    if (measure_skew && skew_init(&skew, significant_digits, straggler_percentage > 0))
+    {
+        fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
+
+    // Warm reference of the same function, then every measurement below runs cold
+    if (bench_cache.kind != CACHE_WARM)
+    {
+        if (cache_init(&bench_cache, my_pe))
+        {
+            fprintf(stream, "[%2d/%2d]: Allocation failed!\n", my_pe, num_pes);
+            shmem_finalize();
+            return EXIT_FAILURE;
+        }
+        run_local_latencies_benchmark(f.func_ptr, &shmem_barrier_all, iterations, skip, &local_latencies, &(minimum->local), &(maximum->local),
+                                      &(warm[0].local), NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        for(i = 0; i < percentages_size; i++)
+            warm[i + 1].local = percentile_latency(&local_latencies, percentages[i]);
+        histogram_reset(&local_latencies);
+        pre_func = &cache_barrier_pollute;
+    }
+
+    if (bench_arrival.name[0])
+    {
+        if (arrival_init(&bench_arrival, my_pe, significant_digits))
+        {
+            if (my_pe == 0)
+                fprintf(stream, "Bad arrival trace or allocation failed!\n");
+            shmem_finalize();
+            return EXIT_FAILURE;
+        }
+        pre_func = &arrival_pre;
+    }
+
+    // Per-iteration records hold every measured iteration. An adaptive run doesn't know its length up front:
+    // the raw dump grows per batch, the trace, the windows and the counters keep the first ITERATIONS_DEFAULT.
+    record_capacity = (adaptive.target > 0) ? ITERATIONS_DEFAULT : iterations;
+    record_skip = (adaptive.target > 0) ? 0 : skip;
+
+    tracing = (trace.prefix[0] != '\0');
+    if (tracing && any_pe_failed(trace_init(&trace, record_capacity + record_skip, record_skip) != 0))
+    {
+        if (my_pe == 0)
+            fprintf(stream, "Allocation failed!\n");
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
+
+    dumping = (dump.prefix[0] != '\0');
+    if (dumping && any_pe_failed(dump_init(&dump, record_capacity) != 0))
+    {
+        if (my_pe == 0)
+            fprintf(stream, "Allocation failed!\n");
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
+
+    windowed = (series.name[0] != '\0');
+    if (windowed && series_init(&series, record_capacity))
+    {
+        if (my_pe == 0)
+            fprintf(stream, "Allocation failed!\n");
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
+
+    if (counters && any_pe_failed(perf_init(&perf, record_capacity) != 0))
+    {
+        if (my_pe == 0)
+            fprintf(stream, "Allocation failed!\n");
+        shmem_finalize();
+        return EXIT_FAILURE;
+    }
+
+    // Noise-free baseline of the same function to measure the amplification against
+    if (noise.kind != NOISE_NONE)
+    {
+        if (noise_init(&noise, my_pe, num_pes, significant_digits))
+        {
+            if (my_pe == 0)
+                fprintf(stream, "Bad straggler PE or allocation failed!\n");
+            shmem_finalize();
+            return EXIT_FAILURE;
+        }
+        run_local_latencies_benchmark(f.func_ptr, pre_func, iterations, skip, &local_latencies, &(minimum->local), &(maximum->local),
+                                      &(baseline[0].local), NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        for(i = 0; i < percentages_size; i++)
+            baseline[i + 1].local = percentile_latency(&local_latencies, percentages[i]);
+        histogram_reset(&local_latencies);
+    }
+    
+    if (adaptive.target > 0)
+    {
+        run_adaptive_latencies_benchmark(f.func_ptr, pre_func, &adaptive, &local_latencies, &(minimum->local), &(maximum->local), &(avg->local),
+                                         percentages, percentages_size, ci,
+                                         measure_skew ? &skew : NULL, (noise.kind != NOISE_NONE) ? &noise : NULL,
+                                         bench_arrival.name[0] ? &bench_arrival : NULL, counters ? &perf : NULL,
+                                         tracing ? &trace : NULL, dumping ? &dump : NULL,
+                                         windowed ? &series : NULL);
+        iterations = adaptive.batches * ADAPTIVE_BATCH_SIZE;
+        skip = adaptive.warmup_batches * ADAPTIVE_BATCH_SIZE;
+    }
+    else
+        run_local_latencies_benchmark(f.func_ptr, pre_func, iterations, skip, &local_latencies, &(minimum->local), &(maximum->local), &(avg->local),
+                                      measure_skew ? &skew : NULL, (noise.kind != NOISE_NONE) ? &noise : NULL,
+                                      bench_arrival.name[0] ? &bench_arrival : NULL, counters ? &perf : NULL,
+                                      tracing ? &trace : NULL, dumping ? &dump : NULL,
+                                      windowed ? &series : NULL);
+
+    // Process Data...
+    for(i = 0; i < percentages_size; i++)
+        tails[i].local = percentile_latency(&local_latencies, percentages[i]);
+    stats_reduce(results, 3 + percentages_size, num_pes);
     
+    if (global_percentiles && histogram_reduce_all(&global_latencies, &local_latencies, 0, 0, num_pes))
+    {
+        fprintf(stream, "[%2d/%2d]: Histogram merge failed!\n", my_pe, num_pes);
+        global_percentiles = 0;
+    }
+
+    print_results(stream, my_pe, iterations, skip, num_pes, minimum->range_from, maximum->range_to, 
+                    avg, tails, percentages, percentages_size, f.func_name,
+                    global_percentiles ? &global_latencies : NULL);
+
+    if (adaptive.target > 0)
+    {
+        for(i = 0; i < 3; i++)
+            stats_reduce(ci[i], percentages_size, num_pes);
+        print_adaptive_results(stream, my_pe, &adaptive, ci, percentages, percentages_size);
+    }
+
+    if (measure_skew)
+    {
+        clock_error[0].local = fabs(bench_clock.offset_ns);
+        clock_error[1].local = fabs(bench_clock.drift);
+        clock_error[2].local = bench_clock.rtt_ns;
+        // A fresh estimate against the model's prediction checks the offset and drift the stamps were mapped with
+        clock_error[3].local = clock_sync_error_ns(SKEW_SYNC_ROUNDS);
+        stats_reduce(clock_error, 4, num_pes);
+        print_skew_results(stream, my_pe, &skew, percentages, percentages_size,
+                           clock_error[0].range_to, clock_error[1].range_to, clock_error[2].range_to, clock_error[3].range_to);
+        if (straggler_percentage > 0)
+            print_straggler_results(stream, my_pe, num_pes, &skew, straggler_percentage, verbosity_level);
+        skew_destroy(&skew);
+    }
+
+    if (noise.kind != NOISE_NONE)
+    {
+        injected[0].local = noise.injected_usec / iterations;
+        for(i = 0; i < percentages_size; i++)
+            injected[i + 1].local = percentile_latency(&noise.injected, percentages[i]);
+        stats_reduce(baseline, 1 + percentages_size, num_pes);
+        stats_reduce(injected, 1 + percentages_size, num_pes);
+        print_noise_results(stream, my_pe, &noise, &baseline[0], &baseline[1], avg, tails,
+                            &injected[0], &injected[1], percentages, percentages_size);
+        noise_destroy(&noise);
+    }
+
+    if (tracing)
+    {
+        if (trace_write(&trace, my_pe, f.func_name, bench_arrival.name[0] ? bench_arrival.name :
+                        (bench_cache.kind != CACHE_WARM) ? bench_cache.name : "shmem_barrier_all"))
+            fprintf(stream, "[%2d/%2d]: Writing the trace failed!\n", my_pe, num_pes);
+        else if (my_pe == 0)
+            fprintf(stream, "# Trace of %ld iterations per PE in %s.PE.json\n", trace.count, trace.prefix);
+        trace_destroy(&trace);
+    }
+
+    if (windowed)
+    {
+        if (series_analyze(&series, (double)histogram_lowest_value_at(&local_latencies,
+                           histogram_counts_index(&local_latencies, histogram_value_at_percentile(&local_latencies, percentages[0]))) / 1000.0,
+                           placements))
+        {
+            if (my_pe == 0)
+                fprintf(stream, "Too many latency windows or allocation failed!\n");
+        }
+        else
+            print_series_results(stream, my_pe, num_pes, &series, percentages[0], verbosity_level);
+        series_destroy(&series);
+    }
+
+    if (dumping)
+    {
+        memset(&dump_info, 0, sizeof(dump_info));
+        dump_info.pe = my_pe;
+        dump_info.num_pes = num_pes;
+        dump_info.iterations = iterations;
+        if (dump.dropped)
+            fprintf(stream, "[%2d/%2d]: Dump buffer full, kept %ld of %d raw latencies!\n", my_pe, num_pes, dump.count, iterations);
+        dump_info.skip = skip;
+        dump_info.ticks_per_usec = bench_timer.ticks_per_usec;
+        gethostname(dump_info.host, sizeof(dump_info.host));
+        dump_info.host[sizeof(dump_info.host) - 1] = '\0';
+        strncpy(dump_info.timer, bench_timer.name, sizeof(dump_info.timer) - 1);
+        strncpy(dump_info.func, f.func_name, sizeof(dump_info.func) - 1);
+        if (dump_write(&dump, &dump_info))
+            fprintf(stream, "[%2d/%2d]: Writing the dump failed!\n", my_pe, num_pes);
+        else if (my_pe == 0)
+            fprintf(stream, "# Raw latencies of %ld iterations per PE in %s%s\n", dump.count, dump.prefix,
+                    dump.shared ? ".bin" : ".PE.bin");
+        dump_destroy(&dump);
+    }
+
+    if (counters)
+    {
+        perf_summarize(&perf, (double)histogram_value_at_percentile(&local_latencies, percentages[0]),
+                       perf_local[0], perf_local[1], perf_local[2]);
+        for (i = 0; i < PERF_EVENTS_MAX; i++)
+        {
+            perf_counters[i].local = perf_local[0][i];
+            perf_counters[PERF_EVENTS_MAX + i].local = perf_local[1][i];
+            perf_counters[2 * PERF_EVENTS_MAX + i].local = perf_local[2][i];
+            perf_counters[3 * PERF_EVENTS_MAX + i].local = perf_available(&perf, i);
+        }
+        stats_reduce(perf_counters, 4 * PERF_EVENTS_MAX, num_pes);
+        print_perf_results(stream, my_pe, &perf, perf_counters, percentages[0]);
+        perf_destroy(&perf);
+    }
+
+    if (bench_arrival.name[0])
+    {
+        print_arrival_results(stream, my_pe, &bench_arrival, percentages, percentages_size);
+        arrival_destroy(&bench_arrival);
+    }
 
-    print_results(stream, my_pe, iterations, skip, num_pes, global_min, global_max, 
-                    &avg, tails, percentages, percentages_size, f.func_name);
+    if (bench_cache.kind != CACHE_WARM)
+    {
+        stats_reduce(warm, 1 + percentages_size, num_pes);
+        print_cache_results(stream, my_pe, &bench_cache, &warm[0], &warm[1], avg, tails, percentages, percentages_size);
+        cache_destroy(&bench_cache);
+    }
 
     // For debugging...
     if (verbosity_level == 2) 
     {
-        int i;
-        for (i = 0; i < iterations; i++) {
-            fprintf(stream, "[%4d:%4d]\titer %7d, latency %15.2f\n", my_pe, num_pes, i, local_latencies[i]);
-        } 
+        char prefix[30];
+        sprintf(prefix, "[%4d:%4d]\t", my_pe, num_pes);
+        histogram_print(stream, &local_latencies, prefix);
     }
 
-    free(local_latencies);
+    // Reuses local_latencies, so it comes after everything that reads the main run's histogram
+    if (placement_breakdown)
+        run_placement_breakdown(stream, my_pe, num_pes, placements, iterations, skip, &local_latencies,
+                                percentages, percentages_size);
+
+out:
+    free(placements);
+    if (global_percentiles)
+        histogram_destroy(&global_latencies);
+    histogram_destroy(&local_latencies);
+    stats_finalize();
+    sync_algorithms_finalize();
     shmem_finalize();
     return EXIT_SUCCESS;
 }
\ No newline at end of file
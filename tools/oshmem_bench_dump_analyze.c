@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define DUMP_FORMAT_ONLY
+#include "../oshmem_bench_dump.h"
+
+#define TOOL                            "OpenSHMEM Sync Tail-Latency Dump Analysis"
+#define MAX_PERCENTAGE_ARRAY_SIZE       (50)
+#define REGIONS_INITIAL                 (1024)
+#define HISTOGRAM_BAR_WIDTH             (50)
+#define HISTOGRAM_BUCKETS               (64)
+
+// Offline analysis of the raw latencies that the tail benchmark writes with -D: maps every file, one file per PE
+// or the shared file of a job, and reports global percentiles, a per-PE and a per-host breakdown and a histogram
+// with power-of-two buckets. Plain C, it needs no OpenSHMEM:
+//   cc -O2 -o oshmem_bench_dump_analyze tools/oshmem_bench_dump_analyze.c
+//   oshmem_bench_dump_analyze [-p 0.99,0.95] PREFIX.*.bin
+typedef struct region{
+    const dump_header_t *header;
+    const int64_t *samples;
+}region_t;
+
+typedef struct summary{
+    long count;
+    double avg, min, max;               // usec
+    double tails[MAX_PERCENTAGE_ARRAY_SIZE];
+}summary_t;
+
+static int compare_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_region(const void *a, const void *b)
+{
+    const region_t *x = (const region_t *)a, *y = (const region_t *)b;
+    int cmp = strncmp(x->header->host, y->header->host, sizeof(x->header->host));
+    return cmp ? cmp : (x->header->pe > y->header->pe) - (x->header->pe < y->header->pe);
+}
+
+// Sorts samples in place. The p-th percentile is the sample at rank floor(n * p) + 1, as in the benchmark's
+// histograms, so offline and online percentiles differ only by the histogram's bin width.
+static void summarize(int64_t *samples, long count, const double *percentages, int percentages_size, summary_t *summary)
+{
+    double sum = 0;
+    long i, rank;
+    memset(summary, 0, sizeof(*summary));
+    summary->count = count;
+    if (count == 0)
+        return;
+    qsort(samples, count, sizeof(int64_t), compare_int64);
+    for (i = 0; i < count; i++)
+        sum += samples[i];
+    summary->avg = sum / count / 1000.0;
+    summary->min = samples[0] / 1000.0;
+    summary->max = samples[count - 1] / 1000.0;
+    for (i = 0; i < percentages_size; i++)
+    {
+        rank = (long)((double)count * percentages[i]);
+        rank = (rank >= count) ? count - 1 : rank;
+        summary->tails[i] = samples[rank] / 1000.0;
+    }
+}
+
+static void print_header(FILE *stream, const char *label, const double *percentages, int percentages_size)
+{
+    int i;
+    fprintf(stream, "%*s", 22, label);
+    fprintf(stream, "%*s", 12, "Samples");
+    fprintf(stream, "%*s", 12, "Avg");
+    fprintf(stream, "%*s", 18, "Range");
+    for (i = 0; i < percentages_size; i++)
+        fprintf(stream, "%*.1f%%", 11, percentages[i] * 100.0);
+    fprintf(stream, "\n");
+}
+
+static void print_row(FILE *stream, const char *label, const summary_t *summary, int percentages_size)
+{
+    char temp_str[64];
+    int i;
+    fprintf(stream, "%*s", 22, label);
+    fprintf(stream, "%*ld", 12, summary->count);
+    fprintf(stream, "%*.2f", 12, summary->avg);
+    sprintf(temp_str, "[%.2f-%.2f]", summary->min, summary->max);
+    fprintf(stream, "%*s", 18, temp_str);
+    for (i = 0; i < percentages_size; i++)
+        fprintf(stream, "%*.2f", 12, summary->tails[i]);
+    fprintf(stream, "\n");
+}
+
+// Buckets [2^b, 2^(b+1)) ns over the sorted samples, with a bar scaled to the fullest bucket.
+static void print_histogram(FILE *stream, const int64_t *sorted, long count)
+{
+    long buckets[HISTOGRAM_BUCKETS] = { 0 }, fullest = 0, i;
+    int b, first = HISTOGRAM_BUCKETS, last = 0, width;
+    char temp_str[64];
+    for (i = 0; i < count; i++)
+    {
+        b = 0;
+        while (b < HISTOGRAM_BUCKETS - 1 && sorted[i] >= ((int64_t)2 << b))
+            b++;
+        buckets[b]++;
+        first = (b < first) ? b : first;
+        last = (b > last) ? b : last;
+    }
+    for (b = first; b <= last; b++)
+        fullest = (buckets[b] > fullest) ? buckets[b] : fullest;
+    fprintf(stream, "%*s%*s%*s\n", 22, "Bucket (usec)", 12, "Samples", 9, "Share");
+    for (b = first; b <= last; b++)
+    {
+        sprintf(temp_str, "[%.3f-%.3f)", (double)((int64_t)1 << b) / 1000.0, (double)((int64_t)2 << b) / 1000.0);
+        fprintf(stream, "%*s", 22, temp_str);
+        fprintf(stream, "%*ld", 12, buckets[b]);
+        fprintf(stream, "%*.2f%%", 8, 100.0 * buckets[b] / count);
+        fprintf(stream, "%s", buckets[b] ? "   " : "");
+        width = (int)((HISTOGRAM_BAR_WIDTH * buckets[b] + fullest - 1) / fullest);
+        while (width-- > 0)
+            fputc('#', stream);
+        fprintf(stream, "\n");
+    }
+}
+
+static void print_usage(FILE *stream, const char *app_name)
+{
+    fprintf(stream, "Usage: %s [options] FILE...\n", app_name);
+    fprintf(stream, "  FILE : Raw latencies written by the tail benchmark with -D, PREFIX.PE.bin or PREFIX.bin.\n");
+    fprintf(stream, "  -p : List tail-latency percentages to report.\n");
+    fprintf(stream, "       By default, PERCENTAGE_LIST = {0.5, 0.99, 0.999}.\n");
+    fprintf(stream, "       e.g., -p 0.99,0.95\n");
+    fprintf(stream, "  -h : Print this help.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    region_t *regions = NULL, *grown;
+    double percentages[MAX_PERCENTAGE_ARRAY_SIZE] = { 0.5, 0.99, 0.999 };
+    int percentages_size = 3;
+    char temp_str[200], label[80], *temp_ptr;
+    int c, i, nregions = 0, nfiles = 0, nhosts = 0;
+    long total = 0, offset, start, r, capacity = 0;
+    int64_t *all, *host_samples;
+    summary_t summary;
+    struct stat st;
+    uint64_t position;
+    const char *map;
+    FILE *stream = stdout;
+    int fd;
+
+    while ((c = getopt(argc, argv, ":hp:")) != -1)
+    {
+        switch (c)
+        {
+        case 'p':
+            strncpy(temp_str, optarg, sizeof(temp_str) - 1);
+            temp_str[sizeof(temp_str) - 1] = '\0';
+            temp_ptr = strtok(temp_str, ",");
+            for (i = 0 ; temp_ptr != NULL ; i++)
+            {
+                if (i >= MAX_PERCENTAGE_ARRAY_SIZE - 1) {
+                    print_usage(stream, argv[0]);
+                    return EXIT_FAILURE;
+                }
+                percentages[i] = atof(temp_ptr);
+                if (percentages[i] < 0 || percentages[i] > 1)
+                {
+                    print_usage(stream, argv[0]);
+                    return EXIT_FAILURE;
+                }
+                temp_ptr = strtok(NULL, ",");
+            }
+            percentages_size = i;
+            if (percentages_size <= 0) {
+                print_usage(stream, argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+
+        case 'h':
+            print_usage(stream, argv[0]);
+            return EXIT_SUCCESS;
+
+        default:
+            print_usage(stream, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        print_usage(stream, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Map every file and walk its regions; the maps stay until exit
+    for (i = optind; i < argc; i++)
+    {
+        if ((fd = open(argv[i], O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+            fprintf(stderr, "%s: can't open\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        if (st.st_size == 0) {
+            close(fd);
+            continue;
+        }
+        map = (const char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "%s: can't map\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        for (position = 0; position < (uint64_t)st.st_size; position += regions[nregions++].header->region_bytes)
+        {
+            const dump_header_t *header = (const dump_header_t *)(map + position);
+            if (!dump_header_valid(header, st.st_size - position)) {
+                fprintf(stderr, "%s: bad dump at offset %llu\n", argv[i], (unsigned long long)position);
+                return EXIT_FAILURE;
+            }
+            if (nregions >= capacity) {
+                capacity = capacity ? 2 * capacity : REGIONS_INITIAL;
+                if ((grown = (region_t *)realloc(regions, capacity * sizeof(region_t))) == NULL) {
+                    fprintf(stderr, "Allocation failed!\n");
+                    return EXIT_FAILURE;
+                }
+                regions = grown;
+            }
+            regions[nregions].header = header;
+            regions[nregions].samples = (const int64_t *)(map + position + header->header_bytes);
+            total += header->samples;
+        }
+        nfiles++;
+    }
+    if (nregions == 0 || total == 0) {
+        fprintf(stderr, "No samples.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Host, then PE order, so that the PEs of a host are adjacent in all
+    qsort(regions, nregions, sizeof(region_t), compare_region);
+    all = (int64_t *)malloc(total * sizeof(int64_t));
+    host_samples = (int64_t *)malloc(total * sizeof(int64_t));
+    if (!all || !host_samples) {
+        fprintf(stderr, "Allocation failed!\n");
+        return EXIT_FAILURE;
+    }
+    for (r = 0, offset = 0; r < nregions; r++) {
+        memcpy(all + offset, regions[r].samples, regions[r].header->samples * sizeof(int64_t));
+        offset += regions[r].header->samples;
+    }
+    memcpy(host_samples, all, total * sizeof(int64_t));
+
+    fprintf(stream, "# %s\n", TOOL);
+    fprintf(stream, "# %s, timer %s (%.3f ticks/usec), %d of %d PEs in %d file(s), %lld iterations + %lld skip per PE\n",
+            regions[0].header->func, regions[0].header->timer, regions[0].header->ticks_per_usec,
+            nregions, regions[0].header->num_pes, nfiles,
+            (long long)regions[0].header->iterations, (long long)regions[0].header->skip);
+    for (r = 1; r < nregions; r++)
+        if (strncmp(regions[r].header->func, regions[0].header->func, sizeof(regions[0].header->func)) ||
+            regions[r].header->num_pes != regions[0].header->num_pes) {
+            fprintf(stream, "# Warning: the files come from different runs (PE %d: %s on %d PEs)\n",
+                    regions[r].header->pe, regions[r].header->func, regions[r].header->num_pes);
+            break;
+        }
+
+    // Per PE, then per host; every range of host_samples is sorted on its own
+    fprintf(stream, "# Per PE (usec)\n");
+    print_header(stream, "PE (host)", percentages, percentages_size);
+    for (r = 0, offset = 0; r < nregions; r++)
+    {
+        summarize(host_samples + offset, regions[r].header->samples, percentages, percentages_size, &summary);
+        snprintf(label, sizeof(label), "%d (%.12s)", regions[r].header->pe, regions[r].header->host);
+        print_row(stream, label, &summary, percentages_size);
+        offset += regions[r].header->samples;
+    }
+    memcpy(host_samples, all, total * sizeof(int64_t));
+    fprintf(stream, "# Per host (usec)\n");
+    print_header(stream, "Host (#PEs)", percentages, percentages_size);
+    for (r = 0, offset = 0; r < nregions; nhosts++)
+    {
+        start = offset;
+        for (i = 0; r + i < nregions &&
+             strncmp(regions[r + i].header->host, regions[r].header->host, sizeof(regions[r].header->host)) == 0; i++)
+            offset += regions[r + i].header->samples;
+        summarize(host_samples + start, offset - start, percentages, percentages_size, &summary);
+        snprintf(label, sizeof(label), "%.16s (%d)", regions[r].header->host, i);
+        print_row(stream, label, &summary, percentages_size);
+        r += i;
+    }
+
+    fprintf(stream, "# All %d PEs on %d host(s) (usec)\n", nregions, nhosts);
+    print_header(stream, "", percentages, percentages_size);
+    summarize(all, total, percentages, percentages_size, &summary);
+    print_row(stream, "Global", &summary, percentages_size);
+    fprintf(stream, "# Histogram\n");
+    print_histogram(stream, all, total);
+
+    free(host_samples);
+    free(all);
+    free(regions);
+    return EXIT_SUCCESS;
+}